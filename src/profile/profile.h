@@ -1,8 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
@@ -19,9 +32,14 @@ public:
     {
         auto finish = steady_clock::now();
         auto dur = finish - start;
-        cerr << message
-             << duration_cast<milliseconds>(dur).count()
-             << " ms" << endl;
+
+        // строка собирается целиком и выводится одной операцией,
+        // чтобы сообщения из разных потоков не перемешивались
+        ostringstream os;
+        os << message
+           << duration_cast<milliseconds>(dur).count()
+           << " ms" << '\n';
+        cerr << os.str();
     }
 
 private:
@@ -32,4 +50,339 @@ private:
 #define UNIQ_ID_IMPL(lineno) _a_local_var_##lineno
 #define UNIQ_ID(lineno) UNIQ_ID_IMPL(lineno)
 
-#define LOG_DURATION(message) LogDuration UNIQ_ID(__LINE__){message};
\ No newline at end of file
+#define LOG_DURATION(message) LogDuration UNIQ_ID(__LINE__){message};
+
+// Иерархический профилировщик.
+//
+// PROFILE_SCOPE("label") замеряет время до конца области видимости с точностью до наносекунд.
+// Вложенные замеры образуют дерево: в отчёте метка выводится как путь "parent/child".
+// Каждый поток копит статистику в свой буфер без блокировок, мьютекс берётся только
+// при первом замере в потоке.
+//
+// Для каждого пути хранятся только накопленные значения: число вызовов, сумма, минимум,
+// максимум и гистограмма длительностей, поэтому память зависит от числа разных путей,
+// а не от числа замеров, и профилировщик можно оставлять включённым в долгоживущем
+// процессе. Перцентили считаются по гистограмме с точностью около 1/8 значения.
+//
+// При завершении программы в cerr печатается сводка по каждому пути: число вызовов,
+// суммарное, минимальное, среднее, максимальное время и перцентили. Если задана
+// переменная окружения PROFILE_TRACE, то в указанный файл дополнительно пишется
+// трасса в формате Chrome Trace Event (открывается в chrome://tracing или Perfetto).
+// Трасса хранит не больше TraceEventsLimit событий на поток, остальные отбрасываются.
+//
+// Профилировщик включается макросом PROFILE_ENABLED, без него PROFILE_SCOPE
+// раскрывается в пустую инструкцию. Метка должна быть строковым литералом
+namespace Profiler
+{
+
+using Clock = steady_clock;
+
+// Логарифмическая гистограмма длительностей в наносекундах: каждая степень двойки
+// делится на SubBuckets корзин, значения меньше 2 * SubBuckets хранятся точно
+class Histogram
+{
+public:
+    static constexpr size_t SubBuckets = 8U;
+    static constexpr size_t BucketsCount = 62U * SubBuckets;
+
+    void Add(int64_t ns)
+    {
+        ++_counts[BucketIndex(static_cast<uint64_t>(max<int64_t>(ns, 0)))];
+    }
+
+    void Merge(const Histogram &other)
+    {
+        for (size_t i = 0U; i < BucketsCount; ++i)
+            _counts[i] += other._counts[i];
+    }
+
+    // Верхняя граница корзины, в которую попал замер с номером p * count
+    int64_t Percentile(double p, uint64_t count) const
+    {
+        const uint64_t rank = min(count - 1U, static_cast<uint64_t>(p * count));
+        uint64_t seen = 0U;
+        for (size_t i = 0U; i < BucketsCount; ++i)
+        {
+            seen += _counts[i];
+            if (seen > rank)
+                return BucketUpperBound(i);
+        }
+        return BucketUpperBound(BucketsCount - 1U);
+    }
+
+private:
+    static size_t BucketIndex(uint64_t ns)
+    {
+        size_t shift = 0U;
+        while (ns >= 2U * SubBuckets)
+        {
+            ns >>= 1U;
+            ++shift;
+        }
+        return shift * SubBuckets + static_cast<size_t>(ns);
+    }
+
+    static int64_t BucketUpperBound(size_t idx)
+    {
+        if (idx < 2U * SubBuckets)
+            return static_cast<int64_t>(idx);
+        const size_t shift = idx / SubBuckets - 1U;
+        const uint64_t mantissa = idx % SubBuckets + SubBuckets;
+        return static_cast<int64_t>(((mantissa + 1U) << shift) - 1U);
+    }
+
+    array<uint64_t, BucketsCount> _counts{};
+};
+
+struct Stat
+{
+    uint64_t count = 0U;
+    int64_t total = 0;
+    int64_t min = numeric_limits<int64_t>::max();
+    int64_t max = 0;
+    Histogram histogram;
+
+    void Add(int64_t ns)
+    {
+        ++count;
+        total += ns;
+        min = std::min(min, ns);
+        max = std::max(max, ns);
+        histogram.Add(ns);
+    }
+
+    void Merge(const Stat &other)
+    {
+        count += other.count;
+        total += other.total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        histogram.Merge(other.histogram);
+    }
+};
+
+// Узел дерева путей потока
+struct PathNode
+{
+    const char *label = nullptr;
+    size_t parent = NoParent;
+    vector<size_t> children;
+    Stat stat;
+
+    static constexpr size_t NoParent = static_cast<size_t>(-1);
+};
+
+struct TraceEvent
+{
+    const char *label = nullptr;
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+};
+
+constexpr size_t TraceEventsLimit = 1U << 20U;
+
+struct ThreadBuffer
+{
+    size_t thread_idx = 0U;
+    vector<PathNode> nodes;
+    vector<size_t> roots;                // узлы верхнего уровня
+    size_t current = PathNode::NoParent; // открытая область верхнего уровня
+
+    vector<TraceEvent> trace;
+    uint64_t trace_dropped = 0U;
+
+    // Узел для области label внутри текущей
+    size_t EnterNode(const char *label)
+    {
+        vector<size_t> &siblings = current == PathNode::NoParent ? roots : nodes[current].children;
+        for (size_t idx : siblings)
+            if (nodes[idx].label == label or strcmp(nodes[idx].label, label) == 0)
+                return current = idx;
+
+        // siblings сначала, потому что push_back в nodes может переместить children
+        const size_t idx = nodes.size();
+        siblings.push_back(idx);
+        nodes.push_back(PathNode{label, current, {}, {}});
+        return current = idx;
+    }
+};
+
+class Registry
+{
+public:
+    static Registry &Instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadBuffer *CreateBuffer()
+    {
+        lock_guard guard(_m);
+        _buffers.push_back(make_unique<ThreadBuffer>());
+        _buffers.back()->thread_idx = _buffers.size() - 1U;
+        return _buffers.back().get();
+    }
+
+    int64_t Now() const
+    {
+        return duration_cast<nanoseconds>(Clock::now() - _start).count();
+    }
+
+    bool TraceEnabled() const
+    {
+        return _trace_path != nullptr;
+    }
+
+    // Сводка по путям. Вызывать, когда замеры в других потоках завершены
+    void PrintSummary(ostream &os) const
+    {
+        map<string, Stat> stats;
+
+        lock_guard guard(_m);
+        for (const auto &buffer : _buffers)
+        {
+            const vector<PathNode> &nodes = buffer->nodes;
+            vector<string> paths(nodes.size());
+            for (size_t i = 0U; i < nodes.size(); ++i)
+            {
+                const PathNode &node = nodes[i];
+                // родитель всегда создаётся раньше ребёнка
+                paths[i] = node.parent == PathNode::NoParent ?
+                    string(node.label) : paths[node.parent] + "/" + node.label;
+
+                // пути, области которых ни разу не закрылись (например, при выходе из main), не учитываем
+                if (node.stat.count == 0U)
+                    continue;
+                stats[paths[i]].Merge(node.stat);
+            }
+        }
+
+        if (stats.empty())
+            return;
+
+        auto us = [](int64_t ns) { return ns / 1000.0; };
+
+        ostringstream out;
+        out << fixed << setprecision(3);
+        out << "profile (us): path | calls | total | min | avg | max | p50 | p90 | p99\n";
+        for (const auto &[path, stat] : stats)
+        {
+            // оценка по гистограмме не выходит за точные минимум и максимум
+            auto percentile = [&stat = stat](double p)
+            { return clamp(stat.histogram.Percentile(p, stat.count), stat.min, stat.max); };
+
+            const size_t depth = count(path.begin(), path.end(), '/');
+            out << string(depth * 2U, ' ') << path
+                << " | " << stat.count
+                << " | " << us(stat.total)
+                << " | " << us(stat.min)
+                << " | " << us(stat.total) / stat.count
+                << " | " << us(stat.max)
+                << " | " << us(percentile(0.5))
+                << " | " << us(percentile(0.9))
+                << " | " << us(percentile(0.99)) << '\n';
+        }
+        os << out.str();
+    }
+
+    void PrintChromeTrace(ostream &os) const
+    {
+        lock_guard guard(_m);
+
+        os << "{\"traceEvents\": [";
+        bool first = true;
+        for (const auto &buffer : _buffers)
+        {
+            for (const TraceEvent &event : buffer->trace)
+            {
+                if (not first)
+                    os << ",";
+                first = false;
+                os << "\n{\"name\": \"" << event.label << "\", \"ph\": \"X\", \"pid\": 1"
+                   << ", \"tid\": " << buffer->thread_idx
+                   << ", \"ts\": " << event.start_ns / 1000.0
+                   << ", \"dur\": " << (event.end_ns - event.start_ns) / 1000.0 << "}";
+            }
+        }
+        os << "\n]}\n";
+    }
+
+    ~Registry()
+    {
+        PrintSummary(cerr);
+
+        if (_trace_path != nullptr)
+        {
+            ofstream trace(_trace_path);
+            PrintChromeTrace(trace);
+
+            uint64_t dropped = 0U;
+            for (const auto &buffer : _buffers)
+                dropped += buffer->trace_dropped;
+            if (dropped > 0U)
+                cerr << "profile: " << dropped << " trace events dropped, limit is "
+                     << TraceEventsLimit << " per thread\n";
+        }
+    }
+
+private:
+    Registry() = default;
+
+    const Clock::time_point _start = Clock::now();
+    const char *const _trace_path = getenv("PROFILE_TRACE");
+    mutable mutex _m;
+    vector<unique_ptr<ThreadBuffer>> _buffers;
+};
+
+inline ThreadBuffer &LocalBuffer()
+{
+    thread_local ThreadBuffer *buffer = Registry::Instance().CreateBuffer();
+    return *buffer;
+}
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char *label)
+        : _buffer(LocalBuffer())
+        , _node(_buffer.EnterNode(label))
+        , _start_ns(Registry::Instance().Now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        const int64_t end_ns = Registry::Instance().Now();
+        PathNode &node = _buffer.nodes[_node];
+        node.stat.Add(end_ns - _start_ns);
+        _buffer.current = node.parent;
+
+        if (Registry::Instance().TraceEnabled())
+        {
+            if (_buffer.trace.size() < TraceEventsLimit)
+                _buffer.trace.push_back(TraceEvent{node.label, _start_ns, end_ns});
+            else
+                ++_buffer.trace_dropped;
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    ThreadBuffer &_buffer;
+    size_t _node = 0U;
+    int64_t _start_ns = 0;
+};
+
+} // namespace Profiler
+
+#define PROFILE_ID_IMPL(lineno) _profile_scope_##lineno
+#define PROFILE_ID(lineno) PROFILE_ID_IMPL(lineno)
+
+#if defined(PROFILE_ENABLED)
+#define PROFILE_SCOPE(label) Profiler::ScopedTimer PROFILE_ID(__LINE__){label}
+#else
+#define PROFILE_SCOPE(label) ((void)0)
+#endif
@@ -1,7 +1,220 @@
 #include "test_runner.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+
+string GetEnv(const char *name)
+{
+    const char *value = getenv(name);
+    return value == nullptr ? string{} : string{value};
+}
+
+map<string, double> LoadBaseline(const string &path)
+{
+    map<string, double> result;
+    ifstream input(path);
+    string name;
+    double mean_ms = 0.0;
+    while (input >> name >> mean_ms)
+        result[name] = mean_ms;
+    return result;
+}
+
+} // namespace
+
+TestRunner::Options TestRunner::Options::FromEnvironment()
+{
+    Options result{};
+
+    result.benchmark = not GetEnv("TEST_BENCH").empty() and GetEnv("TEST_BENCH") != "0";
+    if (const string value = GetEnv("TEST_WARMUP"); not value.empty())
+        result.warmup = stoul(value);
+    if (const string value = GetEnv("TEST_REPEATS"); not value.empty())
+        result.repeats = max<size_t>(stoul(value), 1U);
+    if (const string value = GetEnv("TEST_PARALLEL"); not value.empty())
+        result.parallel = max<size_t>(stoul(value), 1U);
+    result.baseline_path = GetEnv("TEST_BASELINE");
+    result.update_baseline = not GetEnv("TEST_BASELINE_UPDATE").empty() and GetEnv("TEST_BASELINE_UPDATE") != "0";
+    if (const string value = GetEnv("TEST_THRESHOLD"); not value.empty())
+        result.threshold = stod(value);
+
+    // сравнение с базой имеет смысл только при замерах
+    if (not result.baseline_path.empty())
+        result.benchmark = true;
+
+    return result;
+}
+
+TestRunner::TestRunner()
+    : TestRunner(Options::FromEnvironment())
+{
+}
+
+TestRunner::TestRunner(Options options)
+    : _options(std::move(options))
+{
+}
+
+TestRunner::Result TestRunner::Execute(const Task &task) const
+{
+    Result result{task.name, {}, {}};
+
+    const size_t warmup = _options.benchmark ? _options.warmup : 0U;
+    const size_t repeats = _options.benchmark ? _options.repeats : 1U;
+
+    try
+    {
+        for (size_t i = 0U; i < warmup; ++i)
+            task.func();
+
+        for (size_t i = 0U; i < repeats; ++i)
+        {
+            const auto start = chrono::steady_clock::now();
+            task.func();
+            const chrono::duration<double, milli> duration = chrono::steady_clock::now() - start;
+            result.durations_ms.push_back(duration.count());
+        }
+    }
+    catch (exception &e)
+    {
+        result.error = e.what();
+    }
+    catch (...)
+    {
+        result.error = "Unknown exception caught";
+    }
+
+    return result;
+}
+
+void TestRunner::Report(const Result &result)
+{
+    ostringstream os;
+
+    if (not result.error.empty())
+    {
+        ++fail_count;
+        os << result.name << " fail: " << result.error << '\n';
+    }
+    else
+    {
+        os << result.name << " OK";
+
+        if (_options.benchmark and not result.durations_ms.empty())
+        {
+            vector<double> d = result.durations_ms;
+            sort(d.begin(), d.end());
+
+            const double mean = accumulate(d.begin(), d.end(), 0.0) / d.size();
+            double variance = 0.0;
+            for (double x : d)
+                variance += (x - mean) * (x - mean);
+            const double stddev = d.size() > 1U ? sqrt(variance / (d.size() - 1U)) : 0.0;
+
+            os << fixed << setprecision(3)
+               << " [mean " << mean << " ms, sd " << stddev
+               << ", min " << d.front() << ", median " << d[d.size() / 2U]
+               << ", max " << d.back() << ", n " << d.size() << "]";
+        }
+        os << '\n';
+    }
+
+    cerr << os.str();
+    _results.push_back(result);
+}
+
+void TestRunner::Flush()
+{
+    if (_tasks.empty())
+        return;
+
+    vector<Result> results(_tasks.size());
+
+    if (_options.parallel <= 1U or _tasks.size() == 1U)
+    {
+        for (size_t i = 0U; i < _tasks.size(); ++i)
+            results[i] = Execute(_tasks[i]);
+    }
+    else
+    {
+        atomic<size_t> next_task{0U};
+        vector<thread> workers;
+        for (size_t i = 0U; i < min(_options.parallel, _tasks.size()); ++i)
+        {
+            workers.emplace_back([this, &next_task, &results]()
+            {
+                for (size_t idx = next_task++; idx < _tasks.size(); idx = next_task++)
+                    results[idx] = Execute(_tasks[idx]);
+            });
+        }
+        for (thread &worker : workers)
+            worker.join();
+    }
+
+    _tasks.clear();
+    for (const Result &result : results)
+        Report(result);
+}
+
+void TestRunner::CheckBaseline()
+{
+    if (_options.baseline_path.empty())
+        return;
+
+    const map<string, double> baseline = LoadBaseline(_options.baseline_path);
+
+    // слишком короткие тесты не сравниваем, их время определяется шумом
+    static constexpr double MinComparableMs = 1.0;
+
+    map<string, double> current;
+    for (const Result &result : _results)
+    {
+        if (not result.error.empty() or result.durations_ms.empty())
+            continue;
+
+        const double mean = accumulate(result.durations_ms.begin(), result.durations_ms.end(), 0.0) /
+            result.durations_ms.size();
+        current[result.name] = mean;
+
+        auto it = baseline.find(result.name);
+        if (it == baseline.end() or it->second < MinComparableMs)
+            continue;
+
+        if (mean > it->second * (1.0 + _options.threshold))
+        {
+            ++fail_count;
+            ostringstream os;
+            os << fixed << setprecision(3) << result.name << " regression: " << mean
+               << " ms vs baseline " << it->second << " ms (threshold "
+               << _options.threshold * 100.0 << "%)" << '\n';
+            cerr << os.str();
+        }
+    }
+
+    if (_options.update_baseline or baseline.empty())
+    {
+        ofstream output(_options.baseline_path);
+        output << setprecision(6);
+        for (const auto &[name, mean] : current)
+            output << name << ' ' << mean << '\n';
+    }
+}
+
 TestRunner::~TestRunner()
 {
+    Flush();
+    CheckBaseline();
+
     if (fail_count > 0)
     {
         std::cerr << fail_count << " unit tests failed. Terminate" << std::endl;
@@ -12,4 +225,4 @@ TestRunner::~TestRunner()
 void Assert(bool b, const string &hint)
 {
     AssertEqual(b, true, hint);
-}
\ No newline at end of file
+}
@@ -9,6 +9,7 @@
 #include <set>
 #include <string>
 #include <vector>
+#include <functional>
 
 using namespace std;
 
@@ -114,32 +115,72 @@ void AssertEqual(const T &t, const U &u, const string &hint = {})
 
 void Assert(bool b, const string &hint);
 
+// Режим бенчмарка включается переменными окружения, поэтому вызовы RUN_TEST не меняются:
+//   TEST_BENCH=1            замерять время каждого теста
+//   TEST_WARMUP=N           прогонов без замера перед замерами (по умолчанию 1)
+//   TEST_REPEATS=N          прогонов с замером (по умолчанию 5)
+//   TEST_PARALLEL=N         выполнять тесты в N потоках. Тесты должны быть независимыми,
+//                           а замеры в этом режиме зашумлены соседними тестами.
+//                           Строки OK/fail и замеры печатаются в порядке RUN_TEST, а то,
+//                           что тесты сами пишут в cout и cerr, не буферизуется и может
+//                           перемешиваться между потоками
+//   TEST_BASELINE=file      сравнить среднее время с базой из файла; если файла нет,
+//                           он будет создан
+//   TEST_BASELINE_UPDATE=1  перезаписать файл базы текущими замерами
+//   TEST_THRESHOLD=0.2      допустимое относительное замедление, при превышении тест падает
 class TestRunner
 {
 public:
+    struct Options
+    {
+        bool benchmark = false;
+        size_t warmup = 1U;
+        size_t repeats = 5U;
+        size_t parallel = 1U;
+        string baseline_path;
+        bool update_baseline = false;
+        double threshold = 0.2;
+
+        static Options FromEnvironment();
+    };
+
+    TestRunner();
+    explicit TestRunner(Options options);
+
     template <class TestFunc>
     void RunTest(TestFunc func, const string &test_name)
     {
-        try
-        {
-            func();
-            cerr << test_name << " OK" << endl;
-        }
-        catch (exception &e)
-        {
-            ++fail_count;
-            cerr << test_name << " fail: " << e.what() << endl;
-        }
-        catch (...)
-        {
-            ++fail_count;
-            cerr << "Unknown exception caught" << endl;
-        }
+        _tasks.push_back(Task{test_name, std::function<void()>(std::move(func))});
+        if (_options.parallel <= 1U)
+            Flush();
     }
 
+    // Выполняет отложенные тесты. В последовательном режиме тест выполняется сразу в RunTest
+    void Flush();
+
     ~TestRunner();
 
 private:
+    struct Task
+    {
+        string name;
+        std::function<void()> func;
+    };
+
+    struct Result
+    {
+        string name;
+        string error;                  // пусто, если тест прошёл
+        vector<double> durations_ms;   // только замеренные прогоны
+    };
+
+    Result Execute(const Task &task) const;
+    void Report(const Result &result);
+    void CheckBaseline();
+
+    Options _options;
+    vector<Task> _tasks;
+    vector<Result> _results;
     int fail_count = 0;
 };
 
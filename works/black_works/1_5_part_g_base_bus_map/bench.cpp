@@ -0,0 +1,362 @@
+// Бенчмарк справочника на синтетическом городе.
+// Замеряет по отдельности этапы загрузки JSON, построения базы, графа,
+// обработки запросов и отрисовки карты и печатает результат одним JSON объектом,
+// чтобы его можно было сравнивать между коммитами.
+//
+// Пример: bench --seed 7 --stops 5000 --buses 500 --stops-per-bus 30 --requests 20000 --mix 1:1:4
+// С флагом --dump вместо замеров печатается сгенерированный вход для основной программы.
+// С --input file.json замеряется готовый город вместо синтетического
+// С --compact-graph граф строится без лишних рёбер кольцевых маршрутов
+#include "city_generator.h"
+#include "trans.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define TRANS_HAS_RUSAGE
+#endif
+
+using namespace std;
+
+namespace
+{
+
+struct BenchOptions
+{
+    CityOptions city;
+    bool dump = false;
+    string input_path;
+    size_t queue_sources = 200U; // сколько деревьев кратчайших путей строить при сравнении очередей
+    bool compact_graph = false;
+};
+
+BenchOptions ParseBenchOptions(int argc, char *argv[])
+{
+    BenchOptions result{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+
+        auto next_arg = [&]() -> string
+        {
+            if (i + 1 >= argc)
+                throw invalid_argument("Missing value for argument " + string(arg));
+            return argv[++i];
+        };
+
+        if (arg == "--seed")
+            result.city.seed = static_cast<uint32_t>(stoul(next_arg()));
+        else if (arg == "--stops")
+            result.city.stops_count = stoul(next_arg());
+        else if (arg == "--buses")
+            result.city.buses_count = stoul(next_arg());
+        else if (arg == "--stops-per-bus")
+            result.city.stops_per_bus = stoul(next_arg());
+        else if (arg == "--ring-ratio")
+            result.city.ring_ratio = stod(next_arg());
+        else if (arg == "--requests")
+            result.city.requests_count = stoul(next_arg());
+        else if (arg == "--mix")
+        {
+            // доли запросов в виде bus:stop:route
+            const string mix = next_arg();
+            const size_t first = mix.find(':');
+            const size_t second = mix.find(':', first + 1U);
+            if (first == string::npos or second == string::npos)
+                throw invalid_argument("--mix expects bus:stop:route");
+            result.city.bus_share = stod(mix.substr(0U, first));
+            result.city.stop_share = stod(mix.substr(first + 1U, second - first - 1U));
+            result.city.route_share = stod(mix.substr(second + 1U));
+        }
+        else if (arg == "--dump")
+            result.dump = true;
+        else if (arg == "--input")
+            result.input_path = next_arg();
+        else if (arg == "--queue-sources")
+            result.queue_sources = stoul(next_arg());
+        else if (arg == "--compact-graph")
+            result.compact_graph = true;
+        else
+            throw invalid_argument("Unknown argument " + string(arg));
+    }
+
+    return result;
+}
+
+double ToMs(chrono::nanoseconds duration)
+{
+    return duration.count() / 1e6;
+}
+
+template <typename Func>
+chrono::nanoseconds Measure(Func func)
+{
+    const auto start = chrono::steady_clock::now();
+    func();
+    return chrono::steady_clock::now() - start;
+}
+
+long PeakRssKb()
+{
+#if defined(TRANS_HAS_RUSAGE)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024; // на macOS в байтах
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+// Печатает статистику задержек одного типа запросов
+void PrintLatencies(vector<chrono::nanoseconds> &latencies, ostream &os)
+{
+    sort(latencies.begin(), latencies.end());
+
+    chrono::nanoseconds total{};
+    for (chrono::nanoseconds latency : latencies)
+        total += latency;
+
+    auto percentile_us = [&latencies](double p)
+    {
+        if (latencies.empty())
+            return 0.0;
+        const size_t idx = min(latencies.size() - 1U, static_cast<size_t>(p * latencies.size()));
+        return latencies[idx].count() / 1e3;
+    };
+
+    const double total_s = total.count() / 1e9;
+
+    os << "{\"count\": " << latencies.size()
+       << ", \"throughput_rps\": " << (total_s > 0.0 ? latencies.size() / total_s : 0.0)
+       << ", \"mean_us\": " << (latencies.empty() ? 0.0 : total.count() / 1e3 / latencies.size())
+       << ", \"p50_us\": " << percentile_us(0.5)
+       << ", \"p90_us\": " << percentile_us(0.9)
+       << ", \"p99_us\": " << percentile_us(0.99)
+       << ", \"max_us\": " << (latencies.empty() ? 0.0 : latencies.back().count() / 1e3)
+       << "}";
+}
+
+// Строит деревья кратчайших путей из заданных вершин маршрутизатором с очередью Queue
+template <template <typename> class Queue>
+chrono::nanoseconds MeasureQueue(const DataBase &db, const vector<Graph::VertexId> &sources)
+{
+    Graph::Router<Weight, Queue> router(db.graph);
+    return Measure([&]()
+    {
+        for (Graph::VertexId source : sources)
+        {
+            if (auto route = router.BuildRoute(source, source); route)
+                router.ReleaseRoute(route->id);
+        }
+    });
+}
+
+void PrintQueueComparison(const DataBase &db, size_t sources_count, uint32_t seed, ostream &os)
+{
+    vector<Graph::VertexId> sources;
+    mt19937 random(seed);
+    const size_t vertex_count = db.graph.GetVertexCount();
+    for (size_t i = 0U; i < min(sources_count, vertex_count); ++i)
+        sources.push_back(random() % vertex_count);
+
+    auto print = [&os, &sources](string_view name, chrono::nanoseconds duration)
+    {
+        os << "\"" << name << "\": {\"total_ms\": " << ToMs(duration)
+           << ", \"per_source_us\": " << (sources.empty() ? 0.0 : duration.count() / 1e3 / sources.size()) << "}";
+    };
+
+    os << "{\"sources\": " << sources.size() << ", ";
+    print("binary_heap", MeasureQueue<Graph::BinaryHeapQueue>(db, sources));
+    os << ", ";
+    print("quaternary_heap", MeasureQueue<Graph::QuaternaryHeapQueue>(db, sources));
+    os << ", ";
+    print("radix_heap", MeasureQueue<Graph::RadixHeapQueue>(db, sources));
+    os << "}";
+}
+
+int RunBench(const BenchOptions &options)
+{
+    using namespace Json;
+
+    const CityOptions &city = options.city;
+
+    string input;
+    const auto generate_time = Measure([&]()
+    {
+        if (options.input_path.empty())
+            input = GenerateCity(city);
+        else
+        {
+            ifstream file(options.input_path);
+            if (not file)
+                throw runtime_error("Can't open " + options.input_path);
+            input.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        }
+    });
+
+    if (options.dump)
+    {
+        cout << input;
+        return 0;
+    }
+
+    Document doc{Node{}};
+    const auto json_load_time = Measure([&]() { doc = LoadParallel(input); });
+    const map<string, Node> &root = doc.GetRoot().AsMap();
+
+    DataBase db;
+    db.compact_graph = options.compact_graph;
+    const auto build_time = Measure([&]() { BuildDataBase(root, db); });
+    const DataBase::BuildTimings &timings = db.build_timings;
+    const auto base_requests_time = build_time - timings.info - timings.responses - timings.graph;
+
+    // маршрутизатор ленивый: деревья кратчайших путей строятся во время запросов Route
+    optional<Router> router;
+    const auto router_time = Measure([&]() { router.emplace(db.graph); });
+
+    vector<chrono::nanoseconds> bus_latencies;
+    vector<chrono::nanoseconds> stop_latencies;
+    vector<chrono::nanoseconds> route_latencies;
+    vector<chrono::nanoseconds> pareto_latencies;
+    vector<chrono::nanoseconds> uncached_latencies;
+    size_t pareto_routes_count = 0U;
+
+    ostringstream response;
+    response.precision(6);
+
+    const vector<Node> &stat_requests = root.at("stat_requests"s).AsArray();
+    const auto queries_time = Measure([&]()
+    {
+        for (const Node &node : stat_requests)
+        {
+            const map<string, Node> &req = node.AsMap();
+            response.str({});
+
+            const auto latency = Measure([&]() { PrintStatResponse(req, db, *router, response); });
+
+            switch (ToRequestType(req.at("type"s).AsString()))
+            {
+            case RequestType::Bus:
+                bus_latencies.push_back(latency);
+                break;
+            case RequestType::Stop:
+                stop_latencies.push_back(latency);
+                break;
+            case RequestType::Route:
+                route_latencies.push_back(latency);
+                break;
+            default:
+                break;
+            }
+        }
+    });
+
+    // те же запросы Route с "pareto": true и маршрутизатором без кэша деревьев
+    Router uncached_router(db.graph, Graph::TreeCache::Disabled);
+    for (const Node &node : stat_requests)
+    {
+        const map<string, Node> &req = node.AsMap();
+        if (ToRequestType(req.at("type"s).AsString()) != RequestType::Route)
+            continue;
+
+        response.str({});
+        uncached_latencies.push_back(Measure([&]() { PrintStatResponse(req, db, uncached_router, response); }));
+
+        const StopPtr from = make_shared<Stop>(Stop{req.at("from"s).AsString()});
+        const StopPtr to = make_shared<Stop>(Stop{req.at("to"s).AsString()});
+        pareto_latencies.push_back(Measure([&]()
+        {
+            pareto_routes_count += FindParetoRoutes(db.transit, from, to).size();
+        }));
+    }
+
+    const auto create_map_time = Measure([&]() { db.map_svg = CreateMap(db); });
+
+    ostream &os = cout;
+    os << "{\n";
+    // параметры генератора имеют смысл только для синтетического города
+    if (options.input_path.empty())
+    {
+        os << "  \"config\": {\"input\": \"synthetic\""
+           << ", \"seed\": " << city.seed
+           << ", \"stops\": " << city.stops_count
+           << ", \"buses\": " << city.buses_count
+           << ", \"stops_per_bus\": " << city.stops_per_bus
+           << ", \"ring_ratio\": " << city.ring_ratio
+           << ", \"requests\": " << city.requests_count
+           << ", \"mix\": [" << city.bus_share << ", " << city.stop_share << ", " << city.route_share << "]},\n";
+    }
+    else
+    {
+        os << "  \"config\": {\"input\": \"" << options.input_path << "\"},\n";
+    }
+    os << "  \"sizes\": {\"input_bytes\": " << input.size()
+       << ", \"vertices\": " << db.graph.GetVertexCount()
+       << ", \"edges\": " << db.graph.GetEdgeCount()
+       << ", \"edges_skipped\": " << db.graph_stats.skipped_edge_count
+       << ", \"map_bytes\": " << db.map_svg.size() << "},\n";
+    os << "  \"phases_ms\": {"
+       << "\"generate\": " << ToMs(generate_time)
+       << ", \"json_load\": " << ToMs(json_load_time)
+       << ", \"base_requests\": " << ToMs(base_requests_time)
+       << ", \"create_info\": " << ToMs(timings.info)
+       << ", \"create_responses\": " << ToMs(timings.responses)
+       << ", \"create_graph\": " << ToMs(timings.graph)
+       << ", \"router_init\": " << ToMs(router_time)
+       << ", \"queries\": " << ToMs(queries_time)
+       << ", \"create_map\": " << ToMs(create_map_time) << "},\n";
+    os << "  \"queries\": {\"Bus\": ";
+    PrintLatencies(bus_latencies, os);
+    os << ", \"Stop\": ";
+    PrintLatencies(stop_latencies, os);
+    os << ", \"Route\": ";
+    PrintLatencies(route_latencies, os);
+    os << ", \"RouteUncached\": ";
+    PrintLatencies(uncached_latencies, os);
+    os << ", \"RoutePareto\": ";
+    PrintLatencies(pareto_latencies, os);
+    os << "},\n";
+    os << "  \"pareto_routes_per_query\": "
+       << (pareto_latencies.empty() ? 0.0 : static_cast<double>(pareto_routes_count) / pareto_latencies.size()) << ",\n";
+    os << "  \"router_queues\": ";
+    PrintQueueComparison(db, options.queue_sources, city.seed, os);
+    os << ",\n";
+    os << "  \"memory\": ";
+    PrintMemoryReport(db, &*router, os);
+    os << ",\n";
+    os << "  \"peak_rss_kb\": " << PeakRssKb() << "\n";
+    os << "}\n";
+
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        return RunBench(ParseBenchOptions(argc, argv));
+    }
+    catch (exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
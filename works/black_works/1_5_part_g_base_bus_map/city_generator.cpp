@@ -0,0 +1,185 @@
+#include "city_generator.h"
+#include "trans.h"
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+class CityRandom
+{
+public:
+    explicit CityRandom(uint32_t seed)
+        : _engine(seed)
+    {
+    }
+
+    // [0, 1)
+    double Uniform()
+    {
+        return _engine() / 4294967296.0;
+    }
+
+    double Uniform(double from, double to)
+    {
+        return from + (to - from) * Uniform();
+    }
+
+    // [0, n)
+    size_t Index(size_t n)
+    {
+        return static_cast<size_t>(Uniform() * n);
+    }
+
+private:
+    mt19937 _engine;
+};
+
+struct GeneratedStop
+{
+    double latitude = 0.0;
+    double longitude = 0.0;
+    map<size_t, size_t> road_distances; // номер остановки -> метры
+};
+
+struct GeneratedBus
+{
+    vector<size_t> stops;
+    bool ring = false;
+};
+
+string StopName(size_t idx)
+{
+    return "Stop " + to_string(idx);
+}
+
+string BusName(size_t idx)
+{
+    return "Bus " + to_string(idx);
+}
+
+} // namespace
+
+string GenerateCity(const CityOptions &options)
+{
+    CityRandom random(options.seed);
+
+    const size_t stops_count = max<size_t>(options.stops_count, 2U);
+    const size_t stops_per_bus = min(max<size_t>(options.stops_per_bus, 2U), stops_count);
+
+    vector<GeneratedStop> stops(stops_count);
+    for (GeneratedStop &stop : stops)
+    {
+        stop.latitude = random.Uniform(55.55, 55.90);
+        stop.longitude = random.Uniform(37.35, 37.85);
+    }
+
+    // частичная перетасовка Фишера-Йетса даёт уникальные остановки маршрута
+    vector<size_t> permutation(stops_count);
+    for (size_t i = 0U; i < stops_count; ++i)
+        permutation[i] = i;
+
+    vector<GeneratedBus> buses(options.buses_count);
+    vector<bool> used_stops(stops_count, false);
+    for (GeneratedBus &bus : buses)
+    {
+        bus.ring = random.Uniform() < options.ring_ratio;
+
+        for (size_t i = 0U; i < stops_per_bus; ++i)
+        {
+            swap(permutation[i], permutation[i + random.Index(stops_count - i)]);
+            bus.stops.push_back(permutation[i]);
+            used_stops[permutation[i]] = true;
+        }
+        if (bus.ring)
+            bus.stops.push_back(bus.stops.front());
+
+        // у каждой пары соседних остановок должно быть дорожное расстояние
+        for (size_t i = 0U; i + 1U < bus.stops.size(); ++i)
+        {
+            GeneratedStop &from = stops[bus.stops[i]];
+            const GeneratedStop &to = stops[bus.stops[i + 1U]];
+            const double geo = CalcGeoDistance(from.latitude, from.longitude, to.latitude, to.longitude);
+            from.road_distances.emplace(bus.stops[i + 1U], static_cast<size_t>(geo * random.Uniform(1.0, 1.5)) + 1U);
+        }
+    }
+
+    vector<size_t> route_stops;
+    for (size_t i = 0U; i < stops_count; ++i)
+        if (used_stops[i])
+            route_stops.push_back(i);
+
+    ostringstream os;
+    os.precision(9);
+
+    os << "{\n\"routing_settings\": {\"bus_wait_time\": 6, \"bus_velocity\": 40},\n";
+    os << "\"render_settings\": {\"width\": 1200, \"height\": 1200, \"padding\": 50, \"stop_radius\": 5, "
+          "\"line_width\": 14, \"stop_label_font_size\": 20, \"stop_label_offset\": [7, -3], "
+          "\"underlayer_color\": [255, 255, 255, 0.85], \"underlayer_width\": 3, "
+          "\"color_palette\": [\"green\", [255, 160, 0], \"red\"]},\n";
+
+    os << "\"base_requests\": [\n";
+    for (size_t i = 0U; i < stops_count; ++i)
+    {
+        const GeneratedStop &stop = stops[i];
+        os << "{\"type\": \"Stop\", \"name\": \"" << StopName(i) << "\", \"latitude\": " << stop.latitude
+           << ", \"longitude\": " << stop.longitude << ", \"road_distances\": {";
+        for (auto it = stop.road_distances.begin(); it != stop.road_distances.end(); ++it)
+        {
+            if (it != stop.road_distances.begin())
+                os << ", ";
+            os << "\"" << StopName(it->first) << "\": " << it->second;
+        }
+        os << "}},\n";
+    }
+    for (size_t i = 0U; i < buses.size(); ++i)
+    {
+        const GeneratedBus &bus = buses[i];
+        os << "{\"type\": \"Bus\", \"name\": \"" << BusName(i) << "\", \"stops\": [";
+        for (size_t j = 0U; j < bus.stops.size(); ++j)
+        {
+            if (j != 0U)
+                os << ", ";
+            os << "\"" << StopName(bus.stops[j]) << "\"";
+        }
+        os << "], \"is_roundtrip\": " << (bus.ring ? "true" : "false") << "}";
+        if (i + 1U != buses.size())
+            os << ",";
+        os << "\n";
+    }
+    os << "],\n";
+
+    const double shares_sum = options.bus_share + options.stop_share + options.route_share;
+
+    os << "\"stat_requests\": [\n";
+    for (size_t id = 1U; id <= options.requests_count; ++id)
+    {
+        const double kind = random.Uniform() * shares_sum;
+
+        if (kind < options.bus_share and not buses.empty())
+        {
+            os << "{\"type\": \"Bus\", \"name\": \"" << BusName(random.Index(buses.size())) << "\"";
+        }
+        else if (kind < options.bus_share + options.stop_share or route_stops.empty())
+        {
+            os << "{\"type\": \"Stop\", \"name\": \"" << StopName(random.Index(stops_count)) << "\"";
+        }
+        else
+        {
+            os << "{\"type\": \"Route\", \"from\": \"" << StopName(route_stops[random.Index(route_stops.size())])
+               << "\", \"to\": \"" << StopName(route_stops[random.Index(route_stops.size())]) << "\"";
+        }
+        os << ", \"id\": " << id << "}";
+        if (id != options.requests_count)
+            os << ",";
+        os << "\n";
+    }
+    os << "]\n}\n";
+
+    return os.str();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Параметры синтетического города для бенчмарка
+struct CityOptions
+{
+    uint32_t seed = 1U;
+    size_t stops_count = 1000U;
+    size_t buses_count = 100U;
+    size_t stops_per_bus = 20U;   // уникальных остановок в маршруте
+    double ring_ratio = 0.5;      // доля кольцевых маршрутов
+    size_t requests_count = 10000U;
+
+    // относительные доли запросов Bus, Stop и Route в stat_requests
+    double bus_share = 1.0;
+    double stop_share = 1.0;
+    double route_share = 2.0;
+};
+
+// Возвращает входной JSON целиком: base_requests, routing_settings,
+// render_settings и stat_requests.
+// Случайные числа берутся из mt19937 с собственным преобразованием, поэтому при одинаковом
+// seed набор остановок, маршрутов и запросов одинаков везде. Расстояния между соседними
+// остановками считаются через CalcGeoDistance (sin/cos/acos), поэтому побайтно одинаковый
+// JSON гарантирован только для того же бинарника и той же libm
+std::string GenerateCity(const CityOptions &options);
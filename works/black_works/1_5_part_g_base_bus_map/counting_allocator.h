@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// Структуры базы, память которых учитывается отдельно
+enum class MemoryTag
+{
+    Stops,
+    Buses,
+    BusesInfo,
+    RoadRouteLength,
+    VertexMaps,
+    Responses,
+    TagsCount
+};
+
+inline constexpr std::array<std::string_view, static_cast<size_t>(MemoryTag::TagsCount)> MemoryTagNames{
+    "stops", "buses", "buses_info", "road_route_length", "vertex_maps", "responses"
+};
+
+struct MemoryCounter
+{
+    std::atomic<int64_t> bytes{0};        // занято сейчас
+    std::atomic<int64_t> peak_bytes{0};   // максимум за всё время
+    std::atomic<int64_t> allocations{0};  // живых выделений сейчас
+    std::atomic<uint64_t> total_allocations{0U};
+
+    void Allocate(size_t size)
+    {
+        const int64_t current = bytes.fetch_add(size, std::memory_order_relaxed) + static_cast<int64_t>(size);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        total_allocations.fetch_add(1U, std::memory_order_relaxed);
+
+        int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+        while (peak < current and not peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Deallocate(size_t size)
+    {
+        bytes.fetch_sub(size, std::memory_order_relaxed);
+        allocations.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+inline std::array<MemoryCounter, static_cast<size_t>(MemoryTag::TagsCount)> memory_counters;
+
+inline MemoryCounter &GetMemoryCounter(MemoryTag tag)
+{
+    return memory_counters[static_cast<size_t>(tag)];
+}
+
+// Аллокатор поверх std::allocator, который складывает размер каждого выделения
+// в счётчик своей структуры. Все контейнеры одной структуры, включая вложенные,
+// используют аллокатор с одним и тем же тегом
+template <typename T, MemoryTag Tag>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = CountingAllocator<U, Tag>;
+    };
+
+    CountingAllocator() noexcept = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U, Tag> &) noexcept
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        T *result = std::allocator<T>{}.allocate(n);
+        GetMemoryCounter(Tag).Allocate(n * sizeof(T));
+        return result;
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        GetMemoryCounter(Tag).Deallocate(n * sizeof(T));
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U, Tag> &) const noexcept
+    { return true; }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U, Tag> &) const noexcept
+    { return false; }
+};
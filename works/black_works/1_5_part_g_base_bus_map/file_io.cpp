@@ -0,0 +1,146 @@
+#include "file_io.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TRANS_HAS_MMAP
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string &path)
+{
+#if defined(TRANS_HAS_MMAP)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error("Can't open " + path + ": " + strerror(errno));
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 and st.st_size > 0)
+    {
+        void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            // файл читается один раз от начала до конца
+            madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            _data = static_cast<const char *>(data);
+            _size = static_cast<size_t>(st.st_size);
+            _mapped = true;
+        }
+    }
+    close(fd);
+
+    if (_mapped)
+        return;
+#endif
+
+    // пустой файл, не обычный файл (например, канал) или нет mmap
+    ifstream input(path, ios::binary);
+    if (not input)
+        throw runtime_error("Can't open " + path);
+    _content.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    _data = _content.data();
+    _size = _content.size();
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(TRANS_HAS_MMAP)
+    if (_mapped)
+        munmap(const_cast<char *>(_data), _size);
+#endif
+}
+
+string ReadAll(FILE *file)
+{
+    static constexpr size_t BlockSize = 1U << 20U;
+
+    string result;
+    size_t size = 0U;
+    while (true)
+    {
+        result.resize(size + BlockSize);
+        const size_t read = fread(result.data() + size, 1U, BlockSize, file);
+        size += read;
+        if (read < BlockSize)
+            break;
+    }
+    result.resize(size);
+    return result;
+}
+
+OutputBuffer::OutputBuffer(FILE *file, size_t capacity)
+    : _file(file),
+      _buffer(capacity)
+{
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    Flush();
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch)
+{
+    if (not Flush())
+        return traits_type::eof();
+    if (not traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+streamsize OutputBuffer::xsputn(const char *s, streamsize count)
+{
+    const size_t size = static_cast<size_t>(count);
+    const size_t free_space = static_cast<size_t>(epptr() - pptr());
+    if (size <= free_space)
+    {
+        memcpy(pptr(), s, size);
+        pbump(static_cast<int>(size));
+        return count;
+    }
+
+    // блок больше свободного места: сбрасываем накопленное и пишем блок напрямую
+    if (not Flush())
+        return 0;
+    if (size >= _buffer.size())
+        return Write(s, size) ? count : 0;
+
+    memcpy(pptr(), s, size);
+    pbump(static_cast<int>(size));
+    return count;
+}
+
+int OutputBuffer::sync()
+{
+    return Flush() ? 0 : -1;
+}
+
+bool OutputBuffer::Flush()
+{
+    const size_t size = static_cast<size_t>(pptr() - pbase());
+    const bool result = Write(pbase(), size);
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+    return result;
+}
+
+bool OutputBuffer::Write(const char *data, size_t size)
+{
+    if (size == 0U)
+        return true;
+    if (fwrite(data, 1U, size, _file) != size)
+        return false;
+    return fflush(_file) == 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdio>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Файл, отображённый в память только для чтения. Данные доступны, пока жив объект.
+// Там, где mmap недоступен, файл целиком читается в строку.
+// Бросает std::runtime_error, если файл не удалось открыть
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view Data() const
+    { return {_data, _size}; }
+
+private:
+    const char *_data = nullptr;
+    size_t _size = 0U;
+    bool _mapped = false;
+    std::string _content; // если отображение не удалось
+};
+
+// Читает поток до конца блоками, минуя буферизацию iostream
+std::string ReadAll(std::FILE *file);
+
+// Буфер вывода большого объёма: данные копятся в памяти и уходят в файл
+// крупными блоками при переполнении, sync и в деструкторе
+class OutputBuffer : public std::streambuf
+{
+public:
+    explicit OutputBuffer(std::FILE *file, size_t capacity = 1U << 20U);
+    ~OutputBuffer() override;
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *s, std::streamsize count) override;
+    int sync() override;
+
+private:
+    std::FILE *_file;
+    std::vector<char> _buffer;
+
+    bool Flush();
+    bool Write(const char *data, size_t size);
+};
@@ -26,6 +26,22 @@ namespace Graph
 using VertexId = size_t;
 using EdgeId = size_t;
 
+// Оценка занятой кучи по ёмкостям контейнеров
+struct MemoryUsage
+{
+    size_t bytes = 0U;
+    size_t allocations = 0U;
+
+    template <typename Vector>
+    void AddVector(const Vector &v)
+    {
+        if (v.capacity() == 0U)
+            return;
+        bytes += v.capacity() * sizeof(typename Vector::value_type);
+        ++allocations;
+    }
+};
+
 template <typename Weight>
 struct Edge
 {
@@ -60,6 +76,8 @@ public:
     const Edge<Weight> &GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+    MemoryUsage GetMemoryUsage() const;
+
 private:
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
@@ -103,4 +121,15 @@ DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const
     return {std::begin(edges), std::end(edges)};
 }
 
+template <typename Weight>
+MemoryUsage DirectedWeightedGraph<Weight>::GetMemoryUsage() const
+{
+    MemoryUsage result;
+    result.AddVector(edges_);
+    result.AddVector(incidence_lists_);
+    for (const IncidenceList &list : incidence_lists_)
+        result.AddVector(list);
+    return result;
+}
+
 } // namespace Graph
@@ -1,5 +1,14 @@
 #include "json.h"
 
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <streambuf>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 namespace Json
@@ -119,4 +128,233 @@ Document Load(istream &input)
     return Document{LoadNode(input)};
 }
 
-} // namespace Json
\ No newline at end of file
+namespace
+{
+
+// Буфер потока, читающий из уже загруженной памяти без копирования
+class ViewStreamBuf : public std::streambuf
+{
+public:
+    explicit ViewStreamBuf(string_view data)
+    {
+        char *begin = const_cast<char *>(data.data());
+        setg(begin, begin, begin + data.size());
+    }
+};
+
+Node LoadNodeFromView(string_view data)
+{
+    ViewStreamBuf buf(data);
+    istream input(&buf);
+    return LoadNode(input);
+}
+
+bool IsStructuralChar(char c)
+{
+    return c == '"' or c == ',' or c == '{' or c == '}' or c == '[' or c == ']';
+}
+
+// Ищет первый из символов " , { } [ ] начиная с позиции pos.
+// Блоками по 16 байт, если доступен SSE2
+size_t FindStructuralChar(string_view s, size_t pos)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    const __m128i open_bracket = _mm_set1_epi8('[');
+    const __m128i close_bracket = _mm_set1_epi8(']');
+
+    while (pos + 16U <= s.size())
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.data() + pos));
+        const __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, comma)),
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, open_brace), _mm_cmpeq_epi8(chunk, close_brace)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, open_bracket), _mm_cmpeq_epi8(chunk, close_bracket))));
+
+        const int mask = _mm_movemask_epi8(hits);
+        if (mask != 0)
+            return pos + __builtin_ctz(static_cast<unsigned>(mask));
+        pos += 16U;
+    }
+#endif
+    for (; pos < s.size(); ++pos)
+    {
+        if (IsStructuralChar(s[pos]))
+            return pos;
+    }
+    return string_view::npos;
+}
+
+bool IsBlank(string_view s)
+{
+    return s.find_first_not_of(" \t\r\n") == string_view::npos;
+}
+
+// Возвращает позицию сразу за значением, которое начинается с первого
+// непробельного символа начиная с pos. Для скаляров это позиция
+// следующего ',' или закрывающей скобки
+size_t FindValueEnd(string_view s, size_t pos)
+{
+    size_t depth = 0U;
+
+    while (true)
+    {
+        pos = FindStructuralChar(s, pos);
+        if (pos == string_view::npos)
+            return s.size();
+
+        const char c = s[pos];
+        if (c == '"')
+        {
+            pos = s.find('"', pos + 1U);
+            if (pos == string_view::npos)
+                throw runtime_error("Unterminated string");
+            ++pos;
+            if (depth == 0U)
+                return pos;
+            continue;
+        }
+
+        if (c == '{' or c == '[')
+        {
+            ++depth;
+        }
+        else if (c == '}' or c == ']')
+        {
+            if (depth == 0U)
+                return pos;
+            if (--depth == 0U)
+                return pos + 1U;
+        }
+        else if (depth == 0U) // ','
+        {
+            return pos;
+        }
+        ++pos;
+    }
+}
+
+Node LoadArrayParallel(string_view input, size_t threads_count)
+{
+    // маленькие массивы дешевле разобрать в текущем потоке
+    static constexpr size_t MinElementsPerThread = 64U;
+
+    // в одном потоке структурный проход не нужен
+    if (threads_count <= 1U)
+        return LoadNodeFromView(input);
+
+    const vector<string_view> elements = SplitArrayElements(input);
+    vector<Node> result(elements.size());
+
+    const size_t tasks_count = min(max<size_t>(threads_count, 1U),
+                                   max<size_t>(elements.size() / MinElementsPerThread, 1U));
+    const size_t chunk_size = (elements.size() + tasks_count - 1U) / tasks_count;
+
+    auto load_chunk = [&elements, &result](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            result[i] = LoadNodeFromView(elements[i]);
+    };
+
+    vector<future<void>> futures;
+    for (size_t begin = chunk_size; begin < elements.size(); begin += chunk_size)
+    {
+        futures.push_back(async(launch::async, load_chunk,
+                                begin, min(begin + chunk_size, elements.size())));
+    }
+    load_chunk(0U, min(chunk_size, elements.size()));
+
+    for (auto &f : futures)
+        f.get();
+
+    return Node(std::move(result));
+}
+
+} // namespace
+
+vector<string_view> SplitArrayElements(string_view input)
+{
+    vector<string_view> result;
+
+    size_t element_begin = 1U; // пропускаем '['
+    while (true)
+    {
+        // FindValueEnd останавливается на ',' или ']', а после объектов
+        // и строк на следующем за ними символе
+        const size_t element_end = FindValueEnd(input, element_begin);
+        const size_t delimiter = min(FindStructuralChar(input, element_end), input.size());
+
+        const string_view element = input.substr(element_begin, delimiter - element_begin);
+        if (not IsBlank(element))
+            result.push_back(element);
+
+        // как и потоковый парсер, считаем конец входных данных концом массива
+        if (delimiter == input.size() or input[delimiter] == ']')
+            return result;
+        if (input[delimiter] != ',')
+            throw runtime_error("Unexpected symbol in array");
+
+        element_begin = delimiter + 1U;
+    }
+}
+
+namespace
+{
+
+// Разбирает объект верхнего уровня, начиная с input[pos] == '{', массивы в его значениях
+// разбираются параллельно
+Node LoadRootMapParallel(string_view input, size_t pos, size_t threads_count)
+{
+    map<string, Node> root;
+
+    ++pos;
+    while (true)
+    {
+        pos = FindStructuralChar(input, pos);
+        if (pos == string_view::npos or input[pos] == '}')
+            break;
+        if (input[pos] == ',')
+        {
+            ++pos;
+            continue;
+        }
+
+        // input[pos] == '"'
+        const size_t key_end = input.find('"', pos + 1U);
+        if (key_end == string_view::npos)
+            throw runtime_error("Unterminated key");
+        string key(input.substr(pos + 1U, key_end - pos - 1U));
+
+        const size_t value_begin = input.find_first_not_of(" \t\r\n:", key_end + 1U);
+        if (value_begin == string_view::npos)
+            throw runtime_error("Missing value");
+        const size_t value_end = FindValueEnd(input, value_begin);
+        const string_view value = input.substr(value_begin, value_end - value_begin);
+
+        if (input[value_begin] == '[')
+            root.emplace(std::move(key), LoadArrayParallel(value, threads_count));
+        else
+            root.emplace(std::move(key), LoadNodeFromView(value));
+
+        pos = value_end;
+    }
+
+    return Node(std::move(root));
+}
+
+} // namespace
+
+Document LoadParallel(string_view input, size_t threads_count)
+{
+    const size_t root_begin = input.find_first_not_of(" \t\r\n");
+    if (root_begin == string_view::npos or input[root_begin] != '{')
+        return Document{LoadNodeFromView(input)};
+
+    return Document{LoadRootMapParallel(input, root_begin, threads_count)};
+}
+
+} // namespace Json
@@ -2,6 +2,8 @@
 #include <istream>
 #include <map>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <variant>
 #include <vector>
 
@@ -66,4 +68,13 @@ private:
 
 Document Load(std::istream & input);
 
+// Двухфазная загрузка документа из буфера. Сначала структурный проход находит границы
+// элементов массивов верхнего уровня (например, base_requests), затем элементы
+// разбираются параллельно. Порядок элементов совпадает с порядком во входных данных
+Document LoadParallel(std::string_view input,
+                      size_t threads_count = std::thread::hardware_concurrency());
+
+// Возвращает границы элементов массива, который начинается с input[0] == '['
+std::vector<std::string_view> SplitArrayElements(std::string_view input);
+
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "json.h"
 #include "router.h"
 #include "svg.h"
+#include "server.h"
+#include "file_io.h"
 
 void TestAll();
 void Profile();
@@ -14,13 +16,21 @@ void TestAll()
 {
     TestRunner tr{};
     RUN_TEST(tr, TestParseJson);
+    RUN_TEST(tr, TestLoadParallel);
+    RUN_TEST(tr, TestDecodeRequest);
     RUN_TEST(tr, TestParseAddStopQuery);
     RUN_TEST(tr, TestParseAddBusQuery);
     RUN_TEST(tr, TestCalcGeoDistance);
     RUN_TEST(tr, TestDataBaseCreateInfo);
     RUN_TEST(tr, TestDataBaseCreateGraph);
     RUN_TEST(tr, TestBuildRoute);
+    RUN_TEST(tr, TestRouterQueues);
+    RUN_TEST(tr, TestSearchWorkspace);
+    RUN_TEST(tr, TestCompactGraph);
+    RUN_TEST(tr, TestCompactRouteCache);
+    RUN_TEST(tr, TestParetoRoutes);
     RUN_TEST(tr, TestParseRouteQuery);
+    RUN_TEST(tr, TestMemoryReport);
     RUN_TEST(tr, TestParse);
 
     RUN_TEST(tr, TestRgbCout);
@@ -32,19 +42,47 @@ void TestAll()
     RUN_TEST(tr, TestRender0);
     RUN_TEST(tr, TestRender1);
     RUN_TEST(tr, TestRender2);
+    RUN_TEST(tr, TestLongExpected);
+    RUN_TEST(tr, TestMappedFile);
+    RUN_TEST(tr, TestReadAll);
+    RUN_TEST(tr, TestOutputBuffer);
+    RUN_TEST(tr, TestParseFromView);
+    RUN_TEST(tr, TestServerOptions);
 }
 
 void Profile()
 {
 }
 
-int main()
+int main(int argc, char *argv[])
 {
 #if defined(LOCAL_BUILD)
     TestAll();
 #endif
 
+    const ServerOptions options = ParseServerOptions(argc, argv);
+    if (options.serve)
+        return RunServer(options);
+
+    ostream *memory_report = options.memory_report ? &cerr : nullptr;
+
+    // ответ копится в большом буфере и уходит в stdout крупными блоками
+    OutputBuffer output_buffer(stdout);
+    ostream output(&output_buffer);
+
     DataBase db;
-    Parse(cin, cout, db);
+    db.compact_route_cache = options.compact_route_cache;
+    db.compact_graph = options.compact_graph;
+    if (options.input_path.empty())
+        Parse(ReadAll(stdin), output, db, memory_report);
+    else
+    {
+        const MappedFile input(options.input_path);
+        Parse(input.Data(), output, db, memory_report);
+    }
+    output.flush();
+
+    if (options.memory_report)
+        cerr << '\n';
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "pareto_router.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+
+constexpr double Infinity = numeric_limits<double>::infinity();
+
+struct Label
+{
+    double time = Infinity;  // прибытие на остановку с учётом всех ожиданий
+    uint32_t round = 0U;     // раунд, в котором метка получена
+    uint32_t line = 0U;
+    uint32_t board_position = 0U;
+    uint32_t alight_position = 0U;
+};
+
+// Проезд по маршруту в одном направлении. Посадка возможна на любой остановке,
+// до которой добрались в прошлом раунде, и стоит одного ожидания автобуса
+class LineScanner
+{
+public:
+    LineScanner(const TransitIndex &index, const vector<Label> &previous, vector<Label> &current,
+                vector<double> &best, double &target_best, uint32_t target, uint32_t round)
+        : _index(index), _previous(previous), _current(current), _best(best),
+          _target_best(target_best), _target(target), _round(round)
+    {
+    }
+
+    // Проезд от позиции first к концу маршрута (forward) или к его началу
+    void Scan(uint32_t line_idx, size_t first, bool forward, vector<uint32_t> &marked, vector<char> &is_marked)
+    {
+        const TransitIndex::Line &line = _index.lines[line_idx];
+        const size_t count = forward ? line.stops.size() - first : first + 1U;
+
+        double on_board = Infinity;
+        size_t board_position = 0U;
+
+        for (size_t i = 0U, position = first; i < count; ++i, position = forward ? position + 1U : position - 1U)
+        {
+            const uint32_t stop = line.stops[position];
+
+            if (on_board < min(_best[stop], _target_best))
+            {
+                _current[stop] = Label{on_board, _round, line_idx, static_cast<uint32_t>(board_position),
+                                       static_cast<uint32_t>(position)};
+                _best[stop] = on_board;
+                if (stop == _target)
+                    _target_best = on_board;
+                if (not is_marked[stop])
+                {
+                    is_marked[stop] = true;
+                    marked.push_back(stop);
+                }
+            }
+
+            if (const double board = _previous[stop].time + _index.bus_wait_time; board < on_board)
+            {
+                on_board = board;
+                board_position = position;
+            }
+
+            if (i + 1U < count)
+                on_board += forward ? line.forward_time[position] : line.backward_time[position - 1U];
+        }
+    }
+
+private:
+    const TransitIndex &_index;
+    const vector<Label> &_previous;
+    vector<Label> &_current;
+    vector<double> &_best;
+    double &_target_best;
+    const uint32_t _target;
+    const uint32_t _round;
+};
+
+// Восстанавливает маршрут по метке конечной остановки, двигаясь по раундам назад
+RouteQueryAnswer MakeAnswer(const TransitIndex &index, const vector<vector<Label>> &rounds, uint32_t target)
+{
+    RouteQueryAnswer result{};
+    result.total_time = rounds.back()[target].time;
+
+    vector<Item> reversed_items;
+    Label label = rounds.back()[target];
+    while (label.round != 0U)
+    {
+        const TransitIndex::Line &line = index.lines[label.line];
+        const uint32_t board_stop = line.stops[label.board_position];
+        const Label &previous = rounds[label.round - 1U][board_stop];
+
+        reversed_items.push_back(BusItem{
+            .bus = line.bus,
+            .span_count = static_cast<size_t>(label.alight_position > label.board_position ?
+                label.alight_position - label.board_position : label.board_position - label.alight_position),
+            .time = label.time - previous.time - index.bus_wait_time
+        });
+        reversed_items.push_back(WaitItem{ .stop = index.stops[board_stop] });
+
+        label = previous;
+    }
+
+    result.items.assign(reversed_items.rbegin(), reversed_items.rend());
+    return result;
+}
+
+} // namespace
+
+vector<RouteQueryAnswer> FindParetoRoutes(const TransitIndex &index, const StopPtr &from, const StopPtr &to,
+                                          size_t max_rides)
+{
+    PROFILE_SCOPE("FindParetoRoutes");
+
+    auto it_from = index.stop_to_idx.find(from);
+    auto it_to = index.stop_to_idx.find(to);
+    if (it_from == index.stop_to_idx.end() or it_to == index.stop_to_idx.end())
+        return {};
+
+    if (from->name == to->name)
+        return {RouteQueryAnswer{}};
+
+    const uint32_t source = it_from->second;
+    const uint32_t target = it_to->second;
+    const size_t stops_count = index.stops.size();
+
+    // rounds[k][s] — лучшая метка остановки s не более чем за k автобусов
+    vector<vector<Label>> rounds(1U, vector<Label>(stops_count));
+    rounds[0][source].time = 0.0;
+
+    vector<double> best(stops_count, Infinity);
+    best[source] = 0.0;
+    double target_best = Infinity;
+
+    vector<uint32_t> marked{source};
+    vector<char> is_marked(stops_count, false);
+
+    // для каждого маршрута крайние позиции улучшенных остановок: с минимальной
+    // начинается проезд вперёд, с максимальной — назад
+    vector<uint32_t> scan_first(index.lines.size(), numeric_limits<uint32_t>::max());
+    vector<uint32_t> scan_last(index.lines.size(), 0U);
+    vector<uint32_t> lines_to_scan;
+
+    vector<RouteQueryAnswer> result;
+
+    for (uint32_t round = 1U; round <= max_rides and not marked.empty(); ++round)
+    {
+        for (uint32_t stop : marked)
+        {
+            is_marked[stop] = false;
+            for (uint32_t i = index.stop_lines_begin[stop]; i < index.stop_lines_begin[stop + 1U]; ++i)
+            {
+                const auto [line, position] = index.stop_lines[i];
+                if (scan_first[line] == numeric_limits<uint32_t>::max())
+                {
+                    lines_to_scan.push_back(line);
+                    scan_first[line] = scan_last[line] = position;
+                }
+                scan_first[line] = min(scan_first[line], position);
+                scan_last[line] = max(scan_last[line], position);
+            }
+        }
+        marked.clear();
+
+        vector<Label> labels = rounds.back();
+        rounds.push_back(std::move(labels));
+        LineScanner scanner(index, rounds[round - 1U], rounds[round], best, target_best, target, round);
+
+        for (uint32_t line_idx : lines_to_scan)
+        {
+            const TransitIndex::Line &line = index.lines[line_idx];
+            const size_t first = scan_first[line_idx];
+            const size_t last = scan_last[line_idx];
+
+            scanner.Scan(line_idx, first, true, marked, is_marked);
+            if (not line.backward_time.empty())
+                scanner.Scan(line_idx, last, false, marked, is_marked);
+
+            scan_first[line_idx] = numeric_limits<uint32_t>::max();
+        }
+        lines_to_scan.clear();
+
+        if (rounds.back()[target].round == round)
+            result.push_back(MakeAnswer(index, rounds, target));
+    }
+
+    return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "trans_types.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Маршруты автобусов в виде массивов индексов для многокритериального поиска.
+// Время в пути между соседними остановками посчитано заранее в минутах
+struct TransitIndex
+{
+    struct Line
+    {
+        BusPtr bus;
+        vector<uint32_t> stops;       // индексы остановок в порядке следования
+        vector<double> forward_time;  // [i] — время от stops[i] до stops[i + 1]
+        vector<double> backward_time; // [i] — время от stops[i + 1] до stops[i], только для некольцевых
+    };
+
+    // Позиция остановки в маршруте
+    struct LineStop
+    {
+        uint32_t line = 0U;
+        uint32_t position = 0U;
+    };
+
+    vector<StopPtr> stops;
+    unordered_map<StopPtr, uint32_t, NamePtrHasher<StopPtr>, NamePtrKeyEqual<StopPtr>> stop_to_idx;
+
+    vector<Line> lines;
+    // Маршруты, проходящие через остановку: stop_lines[stop_lines_begin[s] .. stop_lines_begin[s + 1])
+    vector<LineStop> stop_lines;
+    vector<uint32_t> stop_lines_begin;
+
+    double bus_wait_time = 0.0; // мин
+};
+
+// Поиск по раундам: k-й раунд находит самое раннее прибытие на каждую остановку,
+// используя не более k автобусов. Метка раунда принимается, только если она строго
+// лучше всех прежних для этой остановки и для конечной, поэтому каждый раунд
+// просматривает лишь маршруты через улучшенные в прошлом раунде остановки.
+//
+// Возвращает все Парето-оптимальные по (total_time, число BusItem) маршруты
+// в порядке возрастания числа автобусов, то есть убывания времени.
+// Пустой результат — маршрута нет
+vector<RouteQueryAnswer> FindParetoRoutes(const TransitIndex &index, const StopPtr &from, const StopPtr &to,
+                                          size_t max_rides = 64U);
@@ -1,4 +1,5 @@
 #include "render.h"
+#include "trans_fields.h"
 
 using namespace std;
 using namespace Json;
@@ -50,22 +51,56 @@ RenderSettings MakeRenderSettigs(const map<string, Json::Node> &render_settings)
 {
     RenderSettings result{};
 
-    result.width = render_settings.at("width"s).AsDouble();
-    result.height = render_settings.at("height"s).AsDouble();
-    result.padding = render_settings.at("padding"s).AsDouble();
-    result.stop_radius = render_settings.at("stop_radius"s).AsDouble();
-    result.line_width = render_settings.at("line_width"s).AsDouble();
-    result.underlayer_width = render_settings.at("underlayer_width"s).AsDouble();
-    result.stop_label_font_size = render_settings.at("stop_label_font_size"s).AsInt();
+    // все поля настроек обязательны
+    static constexpr size_t FieldsCount = 10U;
+    size_t found_count = 0U;
 
-    const vector<Node> &stop_label_offset = render_settings.at("stop_label_offset"s).AsArray();
-    result.stop_label_offset = Point{ stop_label_offset[0].AsDouble(), stop_label_offset[1].AsDouble() };
-
-    result.underlayer_color = MakeColor(render_settings.at("underlayer_color"s));
+    for (const auto &[key, value] : render_settings)
+    {
+        switch (ToField(key))
+        {
+        case Field::Width:
+            result.width = value.AsDouble();
+            break;
+        case Field::Height:
+            result.height = value.AsDouble();
+            break;
+        case Field::Padding:
+            result.padding = value.AsDouble();
+            break;
+        case Field::StopRadius:
+            result.stop_radius = value.AsDouble();
+            break;
+        case Field::LineWidth:
+            result.line_width = value.AsDouble();
+            break;
+        case Field::UnderlayerWidth:
+            result.underlayer_width = value.AsDouble();
+            break;
+        case Field::StopLabelFontSize:
+            result.stop_label_font_size = value.AsInt();
+            break;
+        case Field::StopLabelOffset:
+        {
+            const vector<Node> &stop_label_offset = value.AsArray();
+            result.stop_label_offset = Point{ stop_label_offset[0].AsDouble(), stop_label_offset[1].AsDouble() };
+            break;
+        }
+        case Field::UnderlayerColor:
+            result.underlayer_color = MakeColor(value);
+            break;
+        case Field::ColorPalette:
+            for (const Node &node : value.AsArray())
+                result.color_palette.push_back(MakeColor(node));
+            break;
+        default:
+            continue;
+        }
+        ++found_count;
+    }
 
-    const vector<Node> &color_palette = render_settings.at("color_palette"s).AsArray();
-    for (const Node &node : color_palette)
-        result.color_palette.push_back(MakeColor(node));
+    if (found_count != FieldsCount)
+        throw out_of_range("Missing render settings field");
 
     return result;
 }
@@ -132,7 +167,7 @@ string CreateMap(DataBase &db)
     {
         polyline.SetStrokeColor(bus_color);
 
-        const vector<StopPtr> &stops = bus.lock()->stops;
+        const BusStops &stops = bus.lock()->stops;
         for (const StopPtr &stop : stops)
         {
             polyline.AddPoint(CalcPoint(stop->latitude, stop->longitude));
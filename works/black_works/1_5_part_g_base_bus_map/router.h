@@ -12,19 +12,367 @@
 #include <queue>
 #include <functional>
 #include <limits>
+#include <type_traits>
+#include <array>
+#include <cstring>
 
 namespace Graph
 {
 
+// Очереди с приоритетом для алгоритма Дейкстры. Общий интерфейс:
+//   Queue(size_t vertex_count);
+//   bool Empty() const;
+//   void Push(VertexId vertex, Weight distance); // вставка или уменьшение ключа
+//   std::pair<VertexId, Weight> Pop();          // элемент с минимальным расстоянием
+//   void Clear();                               // опустошает очередь, сохраняя выделенную память
+// Очередь может возвращать устаревшие элементы, у которых расстояние больше уже найденного,
+// алгоритм их пропускает
+
+// Двоичная куча с ленивым удалением: уменьшение ключа добавляет ещё один элемент
+template <typename Weight>
+class BinaryHeapQueue
+{
+public:
+    explicit BinaryHeapQueue(size_t /*vertex_count*/)
+    {
+    }
+
+    bool Empty() const
+    {
+        return heap_.empty();
+    }
+
+    void Push(VertexId vertex, Weight distance)
+    {
+        heap_.push_back({vertex, distance});
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<Element>{});
+    }
+
+    std::pair<VertexId, Weight> Pop()
+    {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Element>{});
+        const Element element = heap_.back();
+        heap_.pop_back();
+        return {element.vertex, element.distance};
+    }
+
+    void Clear()
+    {
+        heap_.clear();
+    }
+
+private:
+    struct Element
+    {
+        VertexId vertex;
+        Weight distance;
+
+        // сравнение только по расстоянию: порядок равных элементов тот же, что был до выделения очередей
+        bool operator>(const Element &other) const
+        {
+            return distance > other.distance;
+        }
+    };
+
+    // те же операции, что у std::priority_queue, но память можно переиспользовать
+    std::vector<Element> heap_;
+};
+
+// Индексированная 4-арная куча. Каждая вершина хранится не более одного раза,
+// уменьшение ключа поднимает её на месте, поэтому устаревших элементов не бывает
 template <typename Weight>
+class QuaternaryHeapQueue
+{
+public:
+    explicit QuaternaryHeapQueue(size_t vertex_count)
+        : positions_(vertex_count, NoPosition)
+    {
+    }
+
+    bool Empty() const
+    {
+        return heap_.empty();
+    }
+
+    void Push(VertexId vertex, Weight distance)
+    {
+        size_t pos = positions_[vertex];
+        if (pos == NoPosition)
+        {
+            pos = heap_.size();
+            heap_.push_back({distance, vertex});
+        }
+        else if (distance < heap_[pos].distance)
+            heap_[pos].distance = distance;
+        else
+            return;
+        SiftUp(pos);
+    }
+
+    std::pair<VertexId, Weight> Pop()
+    {
+        const Element top = heap_.front();
+        positions_[top.vertex] = NoPosition;
+
+        const Element last = heap_.back();
+        heap_.pop_back();
+        if (not heap_.empty())
+        {
+            heap_.front() = last;
+            positions_[last.vertex] = 0U;
+            SiftDown(0U);
+        }
+        return {top.vertex, top.distance};
+    }
+
+    void Clear()
+    {
+        for (const Element &element : heap_)
+            positions_[element.vertex] = NoPosition;
+        heap_.clear();
+    }
+
+private:
+    static constexpr size_t Arity = 4U;
+    static constexpr size_t NoPosition = std::numeric_limits<size_t>::max();
+
+    struct Element
+    {
+        Weight distance;
+        VertexId vertex;
+    };
+
+    std::vector<Element> heap_;
+    std::vector<size_t> positions_;
+
+    void SiftUp(size_t pos)
+    {
+        const Element element = heap_[pos];
+        while (pos != 0U)
+        {
+            const size_t parent = (pos - 1U) / Arity;
+            if (not (element.distance < heap_[parent].distance))
+                break;
+            heap_[pos] = heap_[parent];
+            positions_[heap_[pos].vertex] = pos;
+            pos = parent;
+        }
+        heap_[pos] = element;
+        positions_[element.vertex] = pos;
+    }
+
+    void SiftDown(size_t pos)
+    {
+        const Element element = heap_[pos];
+        while (true)
+        {
+            const size_t first_child = pos * Arity + 1U;
+            if (first_child >= heap_.size())
+                break;
+
+            const size_t last_child = std::min(first_child + Arity, heap_.size());
+            size_t best = first_child;
+            for (size_t child = first_child + 1U; child < last_child; ++child)
+                if (heap_[child].distance < heap_[best].distance)
+                    best = child;
+
+            if (not (heap_[best].distance < element.distance))
+                break;
+            heap_[pos] = heap_[best];
+            positions_[heap_[pos].vertex] = pos;
+            pos = best;
+        }
+        heap_[pos] = element;
+        positions_[element.vertex] = pos;
+    }
+};
+
+// Радиксная куча. Работает, пока извлекаемые ключи не убывают, что выполняется
+// для Дейкстры с неотрицательными весами. Неотрицательные double сравниваются
+// так же, как их битовые представления, поэтому ключом служат биты веса.
+// Элемент попадает в корзину по старшему биту, в котором он отличается от последнего
+// извлечённого ключа, и переносится в младшие корзины только при их опустошении
+template <typename Weight>
+class RadixHeapQueue
+{
+public:
+    explicit RadixHeapQueue(size_t /*vertex_count*/)
+    {
+    }
+
+    bool Empty() const
+    {
+        return size_ == 0U;
+    }
+
+    void Push(VertexId vertex, Weight distance)
+    {
+        const Key key = ToKey(distance);
+        assert(key >= last_);
+        buckets_[BucketIndex(key)].push_back({key, vertex, distance});
+        ++size_;
+    }
+
+    std::pair<VertexId, Weight> Pop()
+    {
+        if (buckets_[0].empty())
+        {
+            size_t idx = 1U;
+            while (buckets_[idx].empty())
+                ++idx;
+
+            std::vector<Element> &bucket = buckets_[idx];
+            last_ = std::min_element(bucket.begin(), bucket.end(),
+                [](const Element &lhs, const Element &rhs) { return lhs.key < rhs.key; })->key;
+            for (const Element &element : bucket)
+                buckets_[BucketIndex(element.key)].push_back(element);
+            bucket.clear();
+        }
+
+        const Element element = buckets_[0].back();
+        buckets_[0].pop_back();
+        --size_;
+        return {element.vertex, element.distance};
+    }
+
+    void Clear()
+    {
+        for (std::vector<Element> &bucket : buckets_)
+            bucket.clear();
+        last_ = 0U;
+        size_ = 0U;
+    }
+
+private:
+    using Key = uint64_t;
+
+    struct Element
+    {
+        Key key;
+        VertexId vertex;
+        Weight distance;
+    };
+
+    static Key ToKey(Weight distance)
+    {
+        if constexpr (std::is_floating_point_v<Weight>)
+        {
+            static_assert(sizeof(Weight) == sizeof(Key), "only double weights are supported");
+            assert(not (distance < 0));
+            Key key = 0U;
+            std::memcpy(&key, &distance, sizeof(key));
+            return key;
+        }
+        else
+            return static_cast<Key>(distance);
+    }
+
+    size_t BucketIndex(Key key) const
+    {
+        if (key == last_)
+            return 0U;
+        return BitWidth(key ^ last_);
+    }
+
+    // номер старшего единичного бита плюс один
+    static size_t BitWidth(Key value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 64U - static_cast<size_t>(__builtin_clzll(value));
+#else
+        size_t width = 0U;
+        for (; value != 0U; value >>= 1U)
+            ++width;
+        return width;
+#endif
+    }
+
+    std::array<std::vector<Element>, 65U> buckets_;
+    Key last_ = 0U;
+    size_t size_ = 0U;
+};
+
+// Память одного поиска, которая переиспользуется от запроса к запросу.
+// Значение вершины действительно, только если её метка равна текущему поколению,
+// поэтому подготовка к новому поиску — это увеличение счётчика, а не заполнение массивов
+template <typename Weight, template <typename> class Queue>
+class SearchWorkspace
+{
+public:
+    void Reset(size_t vertex_count)
+    {
+        if (stamps_.size() != vertex_count)
+        {
+            stamps_.assign(vertex_count, 0U);
+            distances_.resize(vertex_count);
+            prev_edges_.resize(vertex_count);
+            queue_.emplace(vertex_count);
+            generation_ = 0U;
+        }
+
+        if (++generation_ == 0U)
+        {
+            // счётчик переполнился: старые метки могли бы совпасть с новым поколением
+            std::fill(stamps_.begin(), stamps_.end(), 0U);
+            generation_ = 1U;
+        }
+        queue_->Clear();
+    }
+
+    Weight GetDistance(VertexId vertex) const
+    {
+        return stamps_[vertex] == generation_ ? distances_[vertex] : std::numeric_limits<Weight>::max();
+    }
+
+    // Ребро, по которому пришли в вершину. Для стартовой вершины не определено
+    EdgeId GetPrevEdge(VertexId vertex) const
+    {
+        return prev_edges_[vertex];
+    }
+
+    void Set(VertexId vertex, Weight distance, EdgeId prev_edge)
+    {
+        stamps_[vertex] = generation_;
+        distances_[vertex] = distance;
+        prev_edges_[vertex] = prev_edge;
+    }
+
+    Queue<Weight> &GetQueue()
+    {
+        return *queue_;
+    }
+
+private:
+    std::vector<uint32_t> stamps_;
+    std::vector<Weight> distances_;
+    std::vector<EdgeId> prev_edges_;
+    std::optional<Queue<Weight>> queue_;
+    uint32_t generation_ = 0U;
+};
+
+// Способ хранения деревьев кратчайших путей, посчитанных маршрутизатором
+enum class TreeCache
+{
+    Full,     // расстояние и входящее ребро каждой вершины, 24 байта на вершину
+    Compact,  // только 32-битное входящее ребро, 4 байта на вершину; вес пути пересчитывается
+    Disabled  // деревья не хранятся, каждый запрос — поиск до целевой вершины
+};
+
+// По умолчанию используется двоичная куча: из маршрутов с одинаковым временем она выбирает
+// те же, что и раньше, и ответы совпадают с эталонными. Другие очереди быстрее, но при
+// равенстве времени могут выбрать другой маршрут
+template <typename Weight, template <typename> class Queue = BinaryHeapQueue>
 class Router
 {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    // Конструктор теперь «легкий» — работает за O(1)
-    Router(const Graph &graph);
+    // Конструктор теперь «легкий» — работает за O(1).
+    // Деревья кратчайших путей считаются по требованию и запоминаются по стартовой вершине
+    // в виде, заданном cache. Compact требует, чтобы номера рёбер помещались в 32 бита,
+    // иначе используется Full
+    Router(const Graph &graph, TreeCache cache = TreeCache::Full);
 
     using RouteId = uint64_t;
 
@@ -39,8 +387,18 @@ public:
     EdgeId GetRouteEdge(RouteId route_id, size_t edge_idx) const;
     void ReleaseRoute(RouteId route_id);
 
+    // Записывает рёбра маршрута в edges, прежнее содержимое удаляется, и возвращает вес.
+    // Буфер вызывающего переиспользуется, поэтому при посчитанном дереве или без кэша
+    // деревьев запрос не выделяет память
+    std::optional<Weight> BuildRoute(VertexId from, VertexId to, std::vector<EdgeId> &edges) const;
+
+    // Память кэшей маршрутов. Узел хеш-таблицы считается как значение
+    // плюс указатель на следующий узел, поэтому результат приблизительный
+    MemoryUsage GetCacheMemoryUsage() const;
+
 private:
     const Graph &graph_;
+    const TreeCache cache_;
 
     struct VertexRoutes
     {
@@ -52,132 +410,239 @@ private:
     // mutable позволяет изменять кэш внутри const-метода BuildRoute
     mutable std::unordered_map<VertexId, VertexRoutes> computed_routes_cache_;
 
+    // Компактный кэш: входящее ребро вершины или NoCompactEdge.
+    // Вес пути — сумма весов рёбер от начала маршрута, то есть те же сложения
+    // в том же порядке, что и при поиске, поэтому он совпадает с расстоянием побитово
+    static constexpr uint32_t NoCompactEdge = std::numeric_limits<uint32_t>::max();
+    mutable std::unordered_map<VertexId, std::vector<uint32_t>> compact_routes_cache_;
+
     // Кэш развернутых маршрутов
     using ExpandedRoute = std::vector<EdgeId>;
     mutable RouteId next_route_id_ = 0;
     mutable std::unordered_map<RouteId, ExpandedRoute> expanded_routes_cache_;
 
-    struct QueueElement
-    {
-        VertexId vertex;
-        Weight distance;
-
-        bool operator>(const QueueElement &other) const
-        {
-            return distance > other.distance;
-        }
-    };
+    // Дейкстра из from в памяти потока. Если задана to, поиск заканчивается,
+    // как только её расстояние становится окончательным
+    SearchWorkspace<Weight, Queue> &Search(VertexId from, std::optional<VertexId> to) const;
 
     // Вычисление маршрутов из конкретной вершины по требованию
     VertexRoutes ComputeRoutesFromVertex(VertexId source) const;
+    std::vector<uint32_t> ComputeCompactRoutesFromVertex(VertexId source) const;
+
+    // Восстанавливает путь до to по функции входящего ребра и возвращает сумму весов
+    template <typename PrevEdge>
+    Weight ExpandRoute(VertexId from, VertexId to, PrevEdge prev_edge, std::vector<EdgeId> &edges) const;
+
+    // у каждого потока своя рабочая память, общая для всех маршрутизаторов с тем же Queue
+    static SearchWorkspace<Weight, Queue> &Workspace()
+    {
+        static thread_local SearchWorkspace<Weight, Queue> workspace;
+        return workspace;
+    }
 };
 
-template <typename Weight>
-Router<Weight>::Router(const Graph &graph)
-    : graph_(graph)
+template <typename Weight, template <typename> class Queue>
+Router<Weight, Queue>::Router(const Graph &graph, TreeCache cache)
+    : graph_(graph),
+      cache_(cache == TreeCache::Compact and graph.GetEdgeCount() >= NoCompactEdge ? TreeCache::Full : cache)
 {
     // Ничего не считаем заранее, экономим CPU и RAM на старте
 }
 
-template <typename Weight>
-typename Router<Weight>::VertexRoutes Router<Weight>::ComputeRoutesFromVertex(VertexId source) const
+template <typename Weight, template <typename> class Queue>
+SearchWorkspace<Weight, Queue> &Router<Weight, Queue>::Search(VertexId from, std::optional<VertexId> to) const
 {
-    const size_t vertex_count = graph_.GetVertexCount();
-    VertexRoutes result;
-    result.distances.assign(vertex_count, std::numeric_limits<Weight>::max());
-    result.prev_edges.assign(vertex_count, std::nullopt);
+    SearchWorkspace<Weight, Queue> &workspace = Workspace();
+    workspace.Reset(graph_.GetVertexCount());
+    Queue<Weight> &queue = workspace.GetQueue();
 
-    std::priority_queue<QueueElement, std::vector<QueueElement>, std::greater<QueueElement>> queue;
+    workspace.Set(from, 0, 0U);
+    queue.Push(from, 0);
 
-    result.distances[source] = 0;
-    queue.push({source, 0});
-
-    while (!queue.empty())
+    while (not queue.Empty())
     {
-        auto [current_vertex, current_distance] = queue.top();
-        queue.pop();
+        auto [current_vertex, current_distance] = queue.Pop();
 
-        if (current_distance > result.distances[current_vertex])
-        {
+        if (current_distance > workspace.GetDistance(current_vertex))
             continue;
-        }
+
+        // расстояние до извлечённой вершины окончательное, дальше искать не нужно
+        if (current_vertex == to)
+            break;
 
         for (EdgeId edge_id : graph_.GetIncidentEdges(current_vertex))
         {
             const auto &edge = graph_.GetEdge(edge_id);
-            
-            // Защита от переполнения: если текущее расстояние "бесконечность", пропускаем релаксацию
-            if (result.distances[current_vertex] == std::numeric_limits<Weight>::max()) {
-                continue;
-            }
+            const Weight new_distance = current_distance + edge.weight;
 
-            Weight new_distance = result.distances[current_vertex] + edge.weight;
-
-            if (new_distance < result.distances[edge.to])
+            if (new_distance < workspace.GetDistance(edge.to))
             {
-                result.distances[edge.to] = new_distance;
-                result.prev_edges[edge.to] = edge_id;
-                queue.push({edge.to, new_distance});
+                workspace.Set(edge.to, new_distance, edge_id);
+                queue.Push(edge.to, new_distance);
             }
         }
     }
 
-    return result;
+    return workspace;
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from, VertexId to) const
+template <typename Weight, template <typename> class Queue>
+typename Router<Weight, Queue>::VertexRoutes Router<Weight, Queue>::ComputeRoutesFromVertex(VertexId source) const
 {
-    // Шаг 1: Проверяем, запускали ли мы уже Дейкстру из вершины 'from'
-    auto it = computed_routes_cache_.find(from);
-    if (it == computed_routes_cache_.end())
+    const SearchWorkspace<Weight, Queue> &workspace = Search(source, std::nullopt);
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    VertexRoutes result;
+    result.distances.resize(vertex_count);
+    result.prev_edges.assign(vertex_count, std::nullopt);
+
+    for (VertexId vertex = 0U; vertex < vertex_count; ++vertex)
     {
-        // Если нет — запускаем один раз и сохраняем в кэш
-        it = computed_routes_cache_.emplace(from, ComputeRoutesFromVertex(from)).first;
+        result.distances[vertex] = workspace.GetDistance(vertex);
+        if (vertex != source and result.distances[vertex] != std::numeric_limits<Weight>::max())
+            result.prev_edges[vertex] = workspace.GetPrevEdge(vertex);
     }
 
-    const auto &routes = it->second;
+    return result;
+}
+
+template <typename Weight, template <typename> class Queue>
+std::vector<uint32_t> Router<Weight, Queue>::ComputeCompactRoutesFromVertex(VertexId source) const
+{
+    const SearchWorkspace<Weight, Queue> &workspace = Search(source, std::nullopt);
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<uint32_t> result(vertex_count, NoCompactEdge);
 
-    // Шаг 2: Проверяем достижимость целевой вершины
-    if (routes.distances[to] == std::numeric_limits<Weight>::max())
+    for (VertexId vertex = 0U; vertex < vertex_count; ++vertex)
     {
-        return std::nullopt;
+        if (vertex != source and workspace.GetDistance(vertex) != std::numeric_limits<Weight>::max())
+            result[vertex] = static_cast<uint32_t>(workspace.GetPrevEdge(vertex));
     }
 
-    // Шаг 3: Восстанавливаем путь
-    std::vector<EdgeId> edges;
-    VertexId current = to;
+    return result;
+}
 
-    while (current != from)
+template <typename Weight, template <typename> class Queue>
+template <typename PrevEdge>
+Weight Router<Weight, Queue>::ExpandRoute(VertexId from, VertexId to, PrevEdge prev_edge,
+                                          std::vector<EdgeId> &edges) const
+{
+    for (VertexId current = to; current != from;)
     {
-        const auto &edge_id = routes.prev_edges[current];
-        if (!edge_id)
-        {
-            return std::nullopt;
-        }
-        edges.push_back(*edge_id);
-        current = graph_.GetEdge(*edge_id).from;
+        const EdgeId edge_id = prev_edge(current);
+        edges.push_back(edge_id);
+        current = graph_.GetEdge(edge_id).from;
     }
-
     std::reverse(edges.begin(), edges.end());
 
+    Weight weight = 0;
+    for (EdgeId edge_id : edges)
+        weight = weight + graph_.GetEdge(edge_id).weight;
+    return weight;
+}
+
+template <typename Weight, template <typename> class Queue>
+std::optional<typename Router<Weight, Queue>::RouteInfo> Router<Weight, Queue>::BuildRoute(VertexId from, VertexId to) const
+{
+    std::vector<EdgeId> edges;
+    const std::optional<Weight> weight = BuildRoute(from, to, edges);
+    if (not weight)
+        return std::nullopt;
+
     const RouteId route_id = next_route_id_++;
     const size_t route_edge_count = edges.size();
     expanded_routes_cache_[route_id] = std::move(edges);
 
-    return RouteInfo{route_id, routes.distances[to], route_edge_count};
+    return RouteInfo{route_id, *weight, route_edge_count};
 }
 
-template <typename Weight>
-EdgeId Router<Weight>::GetRouteEdge(RouteId route_id, size_t edge_idx) const
+template <typename Weight, template <typename> class Queue>
+std::optional<Weight> Router<Weight, Queue>::BuildRoute(VertexId from, VertexId to, std::vector<EdgeId> &edges) const
+{
+    edges.clear();
+
+    switch (cache_)
+    {
+    case TreeCache::Full:
+    {
+        auto it = computed_routes_cache_.find(from);
+        if (it == computed_routes_cache_.end())
+            it = computed_routes_cache_.emplace(from, ComputeRoutesFromVertex(from)).first;
+
+        const VertexRoutes &routes = it->second;
+        if (routes.distances[to] == std::numeric_limits<Weight>::max())
+            return std::nullopt;
+
+        ExpandRoute(from, to, [&routes](VertexId vertex) { return *routes.prev_edges[vertex]; }, edges);
+        return routes.distances[to];
+    }
+    case TreeCache::Compact:
+    {
+        auto it = compact_routes_cache_.find(from);
+        if (it == compact_routes_cache_.end())
+            it = compact_routes_cache_.emplace(from, ComputeCompactRoutesFromVertex(from)).first;
+
+        const std::vector<uint32_t> &prev_edges = it->second;
+        if (to != from and prev_edges[to] == NoCompactEdge)
+            return std::nullopt;
+
+        return ExpandRoute(from, to, [&prev_edges](VertexId vertex) { return EdgeId{prev_edges[vertex]}; }, edges);
+    }
+    case TreeCache::Disabled:
+    default:
+    {
+        const SearchWorkspace<Weight, Queue> &workspace = Search(from, to);
+        const Weight distance = workspace.GetDistance(to);
+        if (distance == std::numeric_limits<Weight>::max())
+            return std::nullopt;
+
+        ExpandRoute(from, to, [&workspace](VertexId vertex) { return workspace.GetPrevEdge(vertex); }, edges);
+        return distance;
+    }
+    }
+}
+
+template <typename Weight, template <typename> class Queue>
+EdgeId Router<Weight, Queue>::GetRouteEdge(RouteId route_id, size_t edge_idx) const
 {
     return expanded_routes_cache_.at(route_id)[edge_idx];
 }
 
-template <typename Weight>
-void Router<Weight>::ReleaseRoute(RouteId route_id)
+template <typename Weight, template <typename> class Queue>
+void Router<Weight, Queue>::ReleaseRoute(RouteId route_id)
 {
     expanded_routes_cache_.erase(route_id);
 }
 
-} // namespace Graph
\ No newline at end of file
+template <typename Weight, template <typename> class Queue>
+MemoryUsage Router<Weight, Queue>::GetCacheMemoryUsage() const
+{
+    MemoryUsage result;
+
+    auto add_table = [&result](const auto &table)
+    {
+        using Node = typename std::decay_t<decltype(table)>::value_type;
+        result.bytes += table.bucket_count() * sizeof(void *) + table.size() * (sizeof(Node) + sizeof(void *));
+        result.allocations += 1U + table.size();
+    };
+
+    add_table(computed_routes_cache_);
+    for (const auto &[from, routes] : computed_routes_cache_)
+    {
+        result.AddVector(routes.distances);
+        result.AddVector(routes.prev_edges);
+    }
+
+    add_table(compact_routes_cache_);
+    for (const auto &[from, prev_edges] : compact_routes_cache_)
+        result.AddVector(prev_edges);
+
+    add_table(expanded_routes_cache_);
+    for (const auto &[id, route] : expanded_routes_cache_)
+        result.AddVector(route);
+
+    return result;
+}
+
+} // namespace Graph
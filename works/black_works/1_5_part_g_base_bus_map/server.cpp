@@ -0,0 +1,492 @@
+#include "server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TRANS_UNIX_SOCKETS
+#endif
+
+#if defined(TRANS_UNIX_SOCKETS) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+using namespace std;
+
+#if defined(TRANS_UNIX_SOCKETS)
+namespace
+{
+
+// Что закрывает обработчик SIGINT и SIGTERM: слушающий сокет и соединения,
+// которые сейчас обслуживают рабочие потоки; -1 — нет. Из обработчика сигнала
+// можно только читать атомарные переменные и вызывать shutdown
+atomic<int> shutdown_listen_fd{-1};
+atomic<bool> shutdown_requested{false};
+atomic<atomic<int> *> shutdown_connection_fds{nullptr};
+atomic<size_t> shutdown_connections_count{0U};
+
+extern "C" void HandleShutdownSignal(int)
+{
+    shutdown_requested = true;
+    // accept в рабочих потоках вернёт ошибку, а read на соединениях — конец потока
+    if (const int fd = shutdown_listen_fd.load(); fd >= 0)
+        shutdown(fd, SHUT_RDWR);
+
+    atomic<int> *connection_fds = shutdown_connection_fds.load();
+    const size_t count = shutdown_connections_count.load();
+    for (size_t i = 0U; connection_fds != nullptr and i < count; ++i)
+    {
+        if (const int fd = connection_fds[i].load(); fd >= 0)
+            shutdown(fd, SHUT_RD);
+    }
+}
+
+} // namespace
+#endif
+
+void LatencyHistogram::Add(chrono::nanoseconds latency)
+{
+    const uint64_t ns = static_cast<uint64_t>(max<int64_t>(latency.count(), 0));
+    uint64_t us = ns / 1000U;
+
+    size_t bucket = 0U;
+    while (us != 0U and bucket + 1U < BucketsCount)
+    {
+        us >>= 1U;
+        ++bucket;
+    }
+
+    _buckets[bucket].fetch_add(1U, memory_order_relaxed);
+    _count.fetch_add(1U, memory_order_relaxed);
+    _total_ns.fetch_add(ns, memory_order_relaxed);
+
+    uint64_t cur_max = _max_ns.load(memory_order_relaxed);
+    while (cur_max < ns and not _max_ns.compare_exchange_weak(cur_max, ns, memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t LatencyHistogram::Count() const
+{
+    return _count.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::PercentileUs(double percentile) const
+{
+    const uint64_t count = Count();
+    if (count == 0U)
+        return 0U;
+
+    const uint64_t target = max<uint64_t>(1U, static_cast<uint64_t>(ceil(percentile * count)));
+    uint64_t accumulated = 0U;
+    for (size_t i = 0U; i < BucketsCount; ++i)
+    {
+        accumulated += _buckets[i].load(memory_order_relaxed);
+        if (accumulated >= target)
+            return uint64_t{1U} << i;
+    }
+    return uint64_t{1U} << (BucketsCount - 1U);
+}
+
+void LatencyHistogram::Print(ostream &os) const
+{
+    const uint64_t count = Count();
+    const double avg_us = count == 0U ? 0.0 :
+        _total_ns.load(memory_order_relaxed) / 1000.0 / count;
+
+    os << "{\"count\": " << count
+       << ", \"avg_us\": " << avg_us
+       << ", \"max_us\": " << _max_ns.load(memory_order_relaxed) / 1000.0
+       << ", \"p50_us\": " << PercentileUs(0.5)
+       << ", \"p90_us\": " << PercentileUs(0.9)
+       << ", \"p99_us\": " << PercentileUs(0.99)
+       << ", \"buckets\": [";
+
+    // пустые корзины в конце не печатаем
+    size_t last_bucket = BucketsCount;
+    while (last_bucket != 0U and _buckets[last_bucket - 1U].load(memory_order_relaxed) == 0U)
+        --last_bucket;
+
+    for (size_t i = 0U; i < last_bucket; ++i)
+    {
+        if (i != 0U)
+            os << ", ";
+        os << _buckets[i].load(memory_order_relaxed);
+    }
+    os << "]}";
+}
+
+ServerOptions ParseServerOptions(int argc, char *argv[])
+{
+    ServerOptions result{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+
+        auto next_arg = [&]() -> string
+        {
+            if (i + 1 >= argc)
+                throw invalid_argument("Missing value for argument " + string(arg));
+            return argv[++i];
+        };
+
+        if (arg == "--serve")
+            result.serve = true;
+        else if (arg == "--base")
+            result.base_path = next_arg();
+        else if (arg == "--socket")
+            result.socket_path = next_arg();
+        else if (arg == "--threads")
+            result.threads_count = stoul(next_arg());
+        else if (arg == "--memory-report")
+            result.memory_report = true;
+        else if (arg == "--input")
+            result.input_path = next_arg();
+        else if (arg == "--compact-route-cache")
+            result.compact_route_cache = true;
+        else if (arg == "--compact-graph")
+            result.compact_graph = true;
+        else
+            throw invalid_argument("Unknown argument " + string(arg));
+    }
+
+    if (result.serve and result.base_path.empty())
+        throw invalid_argument("--serve requires --base <file>");
+    // в режиме сервера база читается из --base, а запросы — из stdin или сокета
+    if (result.serve and not result.input_path.empty())
+        throw invalid_argument("--input can't be used with --serve, use --base <file>");
+
+    return result;
+}
+
+// Ответы PrintStatResponse отформатированы с отступами, а в режиме сервера
+// каждый ответ должен занимать ровно одну строку.
+// Переводы строк встречаются только между полями, поэтому их можно удалить вместе
+// со следующими за ними отступами, не трогая содержимое строк
+static string CollapseToLine(const string &response)
+{
+    string result;
+    result.reserve(response.size());
+
+    bool skip_spaces = true;
+    for (char c : response)
+    {
+        if (c == '\n')
+        {
+            skip_spaces = true;
+            continue;
+        }
+        if (skip_spaces and c == ' ')
+            continue;
+
+        skip_spaces = false;
+        result.push_back(c);
+    }
+    return result;
+}
+
+TransportServer::WorkerRouter::WorkerRouter(const DirectedWeightedGraph &graph, Graph::TreeCache cache)
+    : router(graph, cache)
+{
+}
+
+TransportServer::TransportServer(DataBase &db)
+    : _db(db)
+{
+    AddRouter();
+}
+
+TransportServer::WorkerRouter &TransportServer::AddRouter()
+{
+    lock_guard guard(_m_routers);
+    return _routers.emplace_back(_db.graph, _db.compact_route_cache ? Graph::TreeCache::Compact : Graph::TreeCache::Full);
+}
+
+string TransportServer::HandleRequest(string_view line)
+{
+    return HandleRequest(line, _routers.front());
+}
+
+string TransportServer::HandleRequest(string_view line, WorkerRouter &router)
+{
+    using namespace Json;
+
+    const auto start = chrono::steady_clock::now();
+    RequestType type = UnknownRequest;
+
+    ostringstream oss;
+    oss.precision(6);
+
+    try
+    {
+        istringstream iss{string(line)};
+        Document doc = Load(iss);
+        const map<string, Node> &req = doc.GetRoot().AsMap();
+        const string &type_name = req.at("type"s).AsString();
+
+        auto it_type = find(RequestTypeNames.begin(), RequestTypeNames.end(), type_name);
+        if (it_type != RequestTypeNames.end())
+            type = static_cast<RequestType>(it_type - RequestTypeNames.begin());
+
+        if (type == StatsRequest)
+        {
+            oss << "{\"request_id\": " << req.at("id"s).AsInt() << ", \"latencies\": ";
+            PrintLatencies(oss);
+            oss << "}";
+        }
+        else if (type == MemoryRequest)
+        {
+            oss << "{\"request_id\": " << req.at("id"s).AsInt() << ", \"memory\": ";
+            PrintMemory(oss);
+            oss << "}";
+        }
+        else if (type == RouteRequest)
+        {
+            lock_guard guard(router.m);
+            PrintStatResponse(req, _db, router.router, oss);
+        }
+        else
+        {
+            // после построения карта только читается
+            if (type == MapRequest)
+                call_once(_map_created, [this]() { _db.map_svg = CreateMap(_db); });
+            PrintStatResponse(req, _db, router.router, oss);
+        }
+    }
+    catch (exception &)
+    {
+        oss.str({});
+        oss << "{\"error_message\": \"bad request\"}";
+    }
+
+    string result = CollapseToLine(oss.str());
+    _latencies[type].Add(chrono::steady_clock::now() - start);
+    return result;
+}
+
+void TransportServer::Serve(istream &is, ostream &os)
+{
+    for (string line; getline(is, line);)
+    {
+        if (line.empty())
+            continue;
+        os << HandleRequest(line) << '\n';
+        os.flush();
+    }
+}
+
+void TransportServer::ServeUnixSocket(const string &path, size_t threads_count)
+{
+#if defined(TRANS_UNIX_SOCKETS)
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        throw runtime_error("Can't create socket");
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        close(listen_fd);
+        throw runtime_error("Socket path is too long: " + path);
+    }
+    copy(path.begin(), path.end(), addr.sun_path);
+
+    unlink(path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 or
+        listen(listen_fd, SOMAXCONN) < 0)
+    {
+        close(listen_fd);
+        throw runtime_error("Can't listen socket " + path);
+    }
+
+    const size_t workers_count = max<size_t>(threads_count, 1U);
+    vector<atomic<int>> connection_fds(workers_count);
+    for (atomic<int> &fd : connection_fds)
+        fd = -1;
+
+    shutdown_requested = false;
+    shutdown_connection_fds = connection_fds.data();
+    shutdown_connections_count = workers_count;
+    shutdown_listen_fd = listen_fd;
+
+    // без SA_RESTART, чтобы прерванные сигналом вызовы возвращали EINTR
+    struct sigaction action{};
+    action.sa_handler = HandleShutdownSignal;
+    sigemptyset(&action.sa_mask);
+    struct sigaction old_int_action{};
+    struct sigaction old_term_action{};
+    sigaction(SIGINT, &action, &old_int_action);
+    sigaction(SIGTERM, &action, &old_term_action);
+
+    // каждый рабочий поток сам принимает соединения и обслуживает
+    // своего клиента до закрытия соединения
+    vector<thread> workers;
+    for (size_t i = 0U; i < workers_count; ++i)
+    {
+        workers.emplace_back([this, listen_fd, &connection_fd = connection_fds[i]]()
+        {
+            WorkerRouter &router = AddRouter();
+            while (true)
+            {
+                const int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd < 0)
+                {
+                    if (errno == EINTR or errno == ECONNABORTED)
+                        continue;
+                    break; // в том числе после shutdown по сигналу
+                }
+
+                connection_fd = fd;
+                // сигнал мог прийти между accept и публикацией соединения
+                if (not shutdown_requested)
+                    ServeConnection(fd, router);
+                connection_fd = -1;
+                close(fd);
+            }
+        });
+    }
+
+    for (thread &worker : workers)
+        worker.join();
+
+    sigaction(SIGINT, &old_int_action, nullptr);
+    sigaction(SIGTERM, &old_term_action, nullptr);
+    shutdown_listen_fd = -1;
+    shutdown_connections_count = 0U;
+    shutdown_connection_fds = nullptr;
+
+    close(listen_fd);
+    unlink(path.c_str());
+#else
+    (void)path;
+    (void)threads_count;
+    throw runtime_error("UNIX-domain sockets are not supported on this platform");
+#endif
+}
+
+void TransportServer::ServeConnection(int fd, WorkerRouter &router)
+{
+#if defined(TRANS_UNIX_SOCKETS)
+    static constexpr size_t ReadBufferSize = 64U * 1024U;
+
+    auto send_all = [fd](const string &data)
+    {
+        size_t sent = 0U;
+        while (sent != data.size())
+        {
+            const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 and errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            sent += n;
+        }
+        return true;
+    };
+
+    string pending;
+    vector<char> buffer(ReadBufferSize);
+
+    while (true)
+    {
+        const ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n < 0 and errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+
+        pending.append(buffer.data(), n);
+
+        string responses;
+        size_t line_begin = 0U;
+        for (size_t line_end = pending.find('\n');
+             line_end != string::npos;
+             line_end = pending.find('\n', line_begin))
+        {
+            string_view line(pending.data() + line_begin, line_end - line_begin);
+            line_begin = line_end + 1U;
+            if (line.empty())
+                continue;
+            responses += HandleRequest(line, router);
+            responses += '\n';
+        }
+        pending.erase(0U, line_begin);
+
+        if (not responses.empty() and not send_all(responses))
+            return;
+    }
+#else
+    (void)fd;
+    (void)router;
+#endif
+}
+
+void TransportServer::PrintLatencies(ostream &os) const
+{
+    os << "{";
+    for (size_t i = 0U; i < RequestTypesCount; ++i)
+    {
+        if (i != 0U)
+            os << ", ";
+        os << "\"" << RequestTypeNames[i] << "\": ";
+        _latencies[i].Print(os);
+    }
+    os << "}";
+}
+
+void TransportServer::PrintMemory(ostream &os)
+{
+    // кэши всех потоков вместе
+    Graph::MemoryUsage router_cache{};
+    {
+        lock_guard guard(_m_routers);
+        for (WorkerRouter &router : _routers)
+        {
+            lock_guard router_guard(router.m);
+            const Graph::MemoryUsage usage = router.router.GetCacheMemoryUsage();
+            router_cache.bytes += usage.bytes;
+            router_cache.allocations += usage.allocations;
+        }
+    }
+    PrintMemoryReport(_db, &router_cache, os);
+}
+
+int RunServer(const ServerOptions &options)
+{
+    ifstream base_input(options.base_path);
+    if (not base_input)
+        throw runtime_error("Can't open base file " + options.base_path);
+
+    DataBase db;
+    db.compact_route_cache = options.compact_route_cache;
+    db.compact_graph = options.compact_graph;
+    {
+        const string input{istreambuf_iterator<char>(base_input), istreambuf_iterator<char>()};
+        Json::Document doc = Json::LoadParallel(input);
+        BuildDataBase(doc.GetRoot().AsMap(), db);
+    }
+
+    TransportServer server(db);
+
+    if (options.socket_path.empty())
+        server.Serve(cin, cout);
+    else
+        server.ServeUnixSocket(options.socket_path, options.threads_count);
+
+    server.PrintLatencies(cerr);
+    cerr << '\n';
+
+    if (options.memory_report)
+    {
+        server.PrintMemory(cerr);
+        cerr << '\n';
+    }
+    return 0;
+}
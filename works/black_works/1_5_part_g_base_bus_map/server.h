@@ -0,0 +1,116 @@
+#pragma once
+#include "trans.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Гистограмма задержек. Корзина i содержит запросы, обработанные
+// за время из диапазона [2^(i-1), 2^i) микросекунд
+class LatencyHistogram
+{
+public:
+    static constexpr size_t BucketsCount = 32U;
+
+    void Add(std::chrono::nanoseconds latency);
+
+    uint64_t Count() const;
+    // возвращает верхнюю границу корзины, в которую попадает перцентиль, в микросекундах
+    uint64_t PercentileUs(double percentile) const;
+
+    // печатает JSON объект со статистикой в одну строку
+    void Print(ostream &os) const;
+
+private:
+    array<atomic<uint64_t>, BucketsCount> _buckets{};
+    atomic<uint64_t> _count{0U};
+    atomic<uint64_t> _total_ns{0U};
+    atomic<uint64_t> _max_ns{0U};
+};
+
+struct ServerOptions
+{
+    bool serve = false;
+    string base_path;   // JSON с base_requests, routing_settings и render_settings
+    string socket_path; // если пусто, то запросы читаются из stdin
+    size_t threads_count = 4U;
+    bool memory_report = false; // печатать в stderr отчёт о памяти базы
+    string input_path;          // если задан, вход отображается в память вместо чтения stdin; не для --serve
+    bool compact_route_cache = false; // хранить деревья маршрутов в компактном виде
+    bool compact_graph = false;       // не добавлять лишние рёбра кольцевых маршрутов
+};
+
+ServerOptions ParseServerOptions(int argc, char *argv[]);
+
+// Долгоживущий режим: база строится один раз, после чего принимаются запросы
+// из stat_requests по одному JSON объекту на строку. На каждый запрос
+// отвечает одна строка с JSON объектом.
+// В режиме сокета SIGINT и SIGTERM закрывают приём и текущие соединения,
+// после чего ServeUnixSocket возвращает управление.
+// Дополнительный запрос { "type": "Stats", "id": 1 } возвращает гистограммы задержек,
+// а { "type": "Memory", "id": 1 } — отчёт о памяти базы и кэшей маршрутизатора
+class TransportServer
+{
+public:
+    explicit TransportServer(DataBase &db);
+
+    // Обрабатывает запрос маршрутизатором, созданным вместе с сервером
+    string HandleRequest(string_view line);
+
+    void Serve(istream &is, ostream &os);
+    void ServeUnixSocket(const string &path, size_t threads_count);
+
+    void PrintLatencies(ostream &os) const;
+    void PrintMemory(ostream &os);
+
+private:
+    enum RequestType
+    {
+        BusRequest,
+        StopRequest,
+        RouteRequest,
+        MapRequest,
+        StatsRequest,
+        MemoryRequest,
+        UnknownRequest,
+        RequestTypesCount
+    };
+
+    static constexpr array<string_view, RequestTypesCount> RequestTypeNames{
+        "Bus", "Stop", "Route", "Map", "Stats", "Memory", "Unknown"
+    };
+
+    // Router кэширует деревья кратчайших путей и не потокобезопасен, поэтому у каждого
+    // обслуживающего потока свой маршрутизатор. Мьютекс берёт только его поток и отчёт
+    // о памяти, так что запросы Route разных клиентов друг друга не ждут
+    struct WorkerRouter
+    {
+        WorkerRouter(const DirectedWeightedGraph &graph, Graph::TreeCache cache);
+
+        Router router;
+        mutex m;
+    };
+
+    DataBase &_db;
+
+    deque<WorkerRouter> _routers; // первый — для HandleRequest без явного маршрутизатора
+    mutex _m_routers;             // добавление в _routers и обход отчётом о памяти
+
+    // карта строится лениво при первом запросе Map, один раз на все потоки
+    once_flag _map_created;
+
+    array<LatencyHistogram, RequestTypesCount> _latencies;
+
+    WorkerRouter &AddRouter();
+    string HandleRequest(string_view line, WorkerRouter &router);
+    void ServeConnection(int fd, WorkerRouter &router);
+};
+
+// Строит базу из options.base_path и обслуживает запросы до закрытия входного потока
+int RunServer(const ServerOptions &options);
@@ -29,6 +29,16 @@ double CalcGeoDistance(double lat1, double lon1, double lat2, double lon2)
 
 void DataBase::CreateInfo(size_t bus_wait_time, double bus_velocity, RenderSettings rs, bool output)
 {
+    PROFILE_SCOPE("CreateInfo");
+
+    auto stage_start = chrono::steady_clock::now();
+    auto finish_stage = [&stage_start](chrono::nanoseconds &duration)
+    {
+        const auto now = chrono::steady_clock::now();
+        duration = now - stage_start;
+        stage_start = now;
+    };
+
     CreateRoutingSettings(bus_wait_time, bus_velocity);
     render_settings = rs;
 
@@ -45,7 +55,9 @@ void DataBase::CreateInfo(size_t bus_wait_time, double bus_velocity, RenderSetti
             info.stops_on_route = bus->stops.size() * 2U - 1U;
         }
 
-        const Stops unique_stops{ bus->stops.begin(), bus->stops.end() };
+        const unordered_set<StopPtr, NamePtrHasher<StopPtr>, NamePtrKeyEqual<StopPtr>> unique_stops{
+            bus->stops.begin(), bus->stops.end()
+        };
         info.unique_stops = unique_stops.size();
 
         for (auto it = bus->stops.begin(); it != bus->stops.end(); ++it)
@@ -87,7 +99,72 @@ void DataBase::CreateInfo(size_t bus_wait_time, double bus_velocity, RenderSetti
             info.route_length_geo *= 2.0;
     }
 
+    finish_stage(build_timings.info);
+
+    CreateResponses();
+    finish_stage(build_timings.responses);
+
     CreateGraph(output);
+    graph_stats.vertex_count = graph.GetVertexCount();
+    graph_stats.edge_count = graph.GetEdgeCount();
+    if (output)
+    {
+        cout << "graph: " << graph_stats.vertex_count << " vertices, " << graph_stats.edge_count << " edges, "
+             << graph_stats.skipped_edge_count << " edges skipped by compact mode" << endl;
+    }
+    CreateTransitIndex();
+    finish_stage(build_timings.graph);
+}
+
+void DataBase::CreateResponses()
+{
+    PROFILE_SCOPE("CreateResponses");
+
+    ostringstream os;
+    os.precision(6);
+
+    auto take = [&os]()
+    {
+        const string result = os.str();
+        os.str({});
+        return ResponseString(result.begin(), result.end());
+    };
+
+    bus_responses.clear();
+    bus_responses.reserve(buses_info.size());
+    for (const auto &[bus, info] : buses_info)
+    {
+        os << "    \"stop_count\": "        << info.stops_on_route    << ",\n"
+           << "    \"unique_stop_count\": " << info.unique_stops      << ",\n"
+           << "    \"route_length\": "      << info.route_length_road << ",\n"
+           << "    \"curvature\": "         << info.curvature()       << "\n";
+        bus_responses.emplace(bus->name, take());
+    }
+
+    stop_responses.clear();
+    stop_responses.reserve(stops.size());
+    for (const StopPtr &stop : stops)
+    {
+        if (not stop->buses.empty())
+        {
+            os << "    \"buses\": [" << '\n';
+
+            for (auto it_bus = stop->buses.begin();
+                 it_bus != stop->buses.end();
+                 ++it_bus)
+            {
+                os << "      \"" << it_bus->lock()->name << '\"';
+                if (next(it_bus) != stop->buses.end())
+                    os << ',';
+                os << '\n';
+            }
+
+            os << "    ]" << '\n';
+        }
+        else
+            os << "    \"buses\": []" << '\n';
+        stop_responses.emplace(stop->name, take());
+    }
 }
 
 void DataBase::CreateRoutingSettings(size_t bus_wait_time, double bus_velocity)
@@ -115,6 +192,8 @@ std::optional<size_t> DataBase::CalcRoadDistance(const StopPtr &lhs, const StopP
 
 void DataBase::CreateGraph(bool debug)
 {
+    PROFILE_SCOPE("CreateGraph");
+
     if (debug)
     {
         size_t num = 0U;
@@ -157,6 +236,7 @@ void DataBase::CreateGraph(bool debug)
     }
 
     graph = DirectedWeightedGraph{ _vertex_id };
+    graph_stats = {};
 
     for (const BusPtr &bus : buses)
     {
@@ -207,8 +287,13 @@ void DataBase::CreateGraph(bool debug)
                 // если это первая остановка, то делаем вид, что это последняя остановка,
                 // которая не имеет следующей остановки, так как конечная, и добавляем
                 // ребро перехода от неё ко второй остановке, учитывающей ещё и затрату на
-                // ожидание автобуса
-                if (it == bus->stops.begin())
+                // ожидание автобуса.
+                // В компактном режиме ребро не нужно: путь через абстрактную остановку
+                // первой остановки имеет тот же вес, хотя из равных по времени маршрутов
+                // может быть выбран другой
+                if (it == bus->stops.begin() and compact_graph)
+                    ++graph_stats.skipped_edge_count;
+                else if (it == bus->stops.begin())
                 {
                     size_t last_stop_pos = bus->stops.size() - 1U;
                     Graph::VertexId vertex_id_from_with_wait_bus = route_unit_to_vertex_id.at(from).at(bus).at(last_stop_pos);
@@ -238,21 +323,90 @@ void DataBase::CreateGraph(bool debug)
 
                 Graph::VertexId shadow_vertex_id = abstract_stop_to_vertex_id[stop];
 
+                // на первую позицию кольца попадают только с абстрактной остановки, поэтому
+                // выход с неё бесполезен, а садиться на последнюю позицию дороже, чем на первую
+                const bool is_ring_first = bus->ring and stop_pos == 0U;
+                const bool is_ring_last = bus->ring and stop_pos == bus->stops.size() - 1U;
+
                 Edge edge{
                     .from = shadow_vertex_id,
                     .to = vertex_id,
                     .weight = routing_settings.meters_past_while_wait_bus / 2.0
                 };
-                graph.AddEdge(edge);
+                if (compact_graph and is_ring_last)
+                    ++graph_stats.skipped_edge_count;
+                else
+                    graph.AddEdge(edge);
 
                 edge.from = vertex_id;
                 edge.to = shadow_vertex_id;
-                graph.AddEdge(edge);
+                if (compact_graph and is_ring_first)
+                    ++graph_stats.skipped_edge_count;
+                else
+                    graph.AddEdge(edge);
             }
         }
     }
 }
 
+void DataBase::CreateTransitIndex()
+{
+    PROFILE_SCOPE("CreateTransitIndex");
+
+    transit = {};
+    transit.bus_wait_time = routing_settings.bus_wait_time;
+
+    auto stop_idx = [this](const StopPtr &stop)
+    {
+        auto [it, inserted] = transit.stop_to_idx.emplace(stop, static_cast<uint32_t>(transit.stops.size()));
+        if (inserted)
+            transit.stops.push_back(stop);
+        return it->second;
+    };
+
+    auto road_time = [this](const StopPtr &from, const StopPtr &to)
+    {
+        return road_route_length.at(from).at(to) / routing_settings.bus_velocity_meters_min;
+    };
+
+    transit.lines.reserve(buses.size());
+    for (const BusPtr &bus : buses)
+    {
+        TransitIndex::Line &line = transit.lines.emplace_back();
+        line.bus = bus;
+        line.stops.reserve(bus->stops.size());
+
+        for (auto it = bus->stops.begin(); it != bus->stops.end(); ++it)
+        {
+            line.stops.push_back(stop_idx(*it));
+
+            auto it_next = next(it);
+            if (it_next == bus->stops.end())
+                break;
+
+            line.forward_time.push_back(road_time(*it, *it_next));
+            if (not bus->ring)
+                line.backward_time.push_back(road_time(*it_next, *it));
+        }
+    }
+
+    // раскладываем позиции остановок в маршрутах по остановкам подсчётом
+    transit.stop_lines_begin.assign(transit.stops.size() + 1U, 0U);
+    for (const TransitIndex::Line &line : transit.lines)
+        for (uint32_t stop : line.stops)
+            ++transit.stop_lines_begin[stop + 1U];
+    partial_sum(transit.stop_lines_begin.begin(), transit.stop_lines_begin.end(), transit.stop_lines_begin.begin());
+
+    transit.stop_lines.resize(transit.stop_lines_begin.back());
+    vector<uint32_t> fill = transit.stop_lines_begin;
+    for (uint32_t line_idx = 0U; line_idx < transit.lines.size(); ++line_idx)
+    {
+        const vector<uint32_t> &line_stops = transit.lines[line_idx].stops;
+        for (uint32_t position = 0U; position < line_stops.size(); ++position)
+            transit.stop_lines[fill[line_stops[position]]++] = {line_idx, position};
+    }
+}
+
 /*
 {
     "type": "Stop",
@@ -268,13 +422,18 @@ void DataBase::CreateGraph(bool debug)
 */
 StopPtr ParseAddStopQuery(const map<string, Json::Node> &req, DataBase &db)
 {
-    StopPtr result = make_shared<Stop>();
+    return ParseAddStopQuery(DecodeRequest(req), db);
+}
 
-    result->name = req.at("name"s).AsString();
-    result->latitude = req.at("latitude"s).AsDouble();
-    result->longitude = req.at("longitude"s).AsDouble();
+StopPtr ParseAddStopQuery(const RequestFields &req, DataBase &db)
+{
+    StopPtr result = MakeStop();
+
+    result->name = Required(req.name, "name");
+    result->latitude = Required(req.latitude, "latitude");
+    result->longitude = Required(req.longitude, "longitude");
 
-    const map<string, Json::Node> &road_distances = req.at("road_distances").AsMap();
+    const map<string, Json::Node> &road_distances = Required(req.road_distances, "road_distances");
 
     if (road_distances.empty())
         return result;
@@ -286,7 +445,7 @@ StopPtr ParseAddStopQuery(const map<string, Json::Node> &req, DataBase &db)
         const string &stop_name = p.first;
         const size_t road_distance = p.second.AsInt();
 
-        auto [it_stop, inserted] = db.stops.insert(make_shared<Stop>(Stop{ stop_name }));
+        auto [it_stop, inserted] = db.stops.insert(MakeStop(Stop{ stop_name }));
 
         road_route_length[*it_stop] = road_distance;
 
@@ -316,22 +475,27 @@ StopPtr ParseAddStopQuery(const map<string, Json::Node> &req, DataBase &db)
 }
 */
 BusPtr ParseAddBusQuery(const map<string, Json::Node> &req, Stops &stops)
+{
+    return ParseAddBusQuery(DecodeRequest(req), stops);
+}
+
+BusPtr ParseAddBusQuery(const RequestFields &req, Stops &stops)
 {
     using namespace Json;
 
-    BusPtr result = make_shared<Bus>();
-    result->name = req.at("name"s).AsString();
-    result->ring = req.at("is_roundtrip"s).AsBool();
+    BusPtr result = MakeBus();
+    result->name = Required(req.name, "name");
+    result->ring = Required(req.is_roundtrip, "is_roundtrip");
 
     auto push_stop = [&stops, &result](string name)
     {
-        StopPtr stop = make_shared<Stop>(Stop{ std::move(name) });
+        StopPtr stop = MakeStop(Stop{ std::move(name) });
         auto [it, inserted] = stops.insert(stop);
         result->stops.push_back(*it);
         it->get()->buses.insert(result);
     };
 
-    const vector<Node> json_stops = req.at("stops"s).AsArray();
+    const vector<Node> &json_stops = Required(req.stops, "stops");
 
     if (json_stops.empty())
         throw runtime_error("bus don't have stops");
@@ -398,16 +562,18 @@ std::optional<RouteQueryAnswer> ParseRouteQuery(StopPtr from, StopPtr to, DataBa
     else
         vertex_id_to = db.route_unit_to_vertex_id.at(to).cbegin()->second.cbegin()->second;
 
-    std::optional<RouteInfo> router_info = router.BuildRoute(vertex_id_from, vertex_id_to);
+    // буфер потока: после первых запросов построение маршрута не выделяет память
+    static thread_local vector<Graph::EdgeId> route_edges;
+    const std::optional<Weight> route_weight = router.BuildRoute(vertex_id_from, vertex_id_to, route_edges);
 
-    if (not router_info)
+    if (not route_weight)
         return std::nullopt;
 
     RouteQueryAnswer result{};
 
     // суммарное время равно длина дороги в метрах, делённая на скорость (метры/мин), плюс
     // время на ожидание первого автобуса
-    result.total_time = router_info->weight / db.routing_settings.bus_velocity_meters_min +
+    result.total_time = *route_weight / db.routing_settings.bus_velocity_meters_min +
         db.routing_settings.bus_wait_time;
 
     // если первая вершина или последняя абстрактные, сделанная для пересадки между автобусами,
@@ -418,7 +584,7 @@ std::optional<RouteQueryAnswer> ParseRouteQuery(StopPtr from, StopPtr to, DataBa
     if (is_to_abstract_vertex)
         result.total_time -= db.routing_settings.bus_wait_time / 2.0;
 
-    size_t edge_count = router_info->edge_count;
+    size_t edge_count = route_edges.size();
 
     // последнее ребро не учитываем, так как оно ведёт к абстрактной остановке
     if (is_to_abstract_vertex)
@@ -445,7 +611,7 @@ std::optional<RouteQueryAnswer> ParseRouteQuery(StopPtr from, StopPtr to, DataBa
 
     for (size_t i = begin_edge_idx; i < edge_count; ++i)
     {
-        Graph::EdgeId edge_id = router.GetRouteEdge(router_info->id, i);
+        Graph::EdgeId edge_id = route_edges[i];
         Graph::Edge edge = db.graph.GetEdge(edge_id);
 
         const auto &[stop_from, bus_from, stop_pos_from] = db.vertex_id_to_route_unit.at(edge.from);
@@ -462,6 +628,9 @@ std::optional<RouteQueryAnswer> ParseRouteQuery(StopPtr from, StopPtr to, DataBa
             continue;
         }
 
+        // с последней позиции кольца на другую позицию маршрута ведёт только ребро на вторую
+        // остановку с ожиданием автобуса. В компактном графе его нет, поэтому ветка
+        // выполняется только для полного графа
         size_t last_stop_pos = bus_from->stops.size() - 1U;
         if (bus_from->ring and stop_pos_from == last_stop_pos)
         {
@@ -485,29 +654,23 @@ std::optional<RouteQueryAnswer> ParseRouteQuery(StopPtr from, StopPtr to, DataBa
         }
     }
 
-    router.ReleaseRoute(router_info->id);
-
     return result;
 }
 
-void Parse(istream &is, ostream &os, DataBase &db)
+void BuildDataBase(const map<string, Json::Node> &root, DataBase &db)
 {
+    PROFILE_SCOPE("BuildDataBase");
     using namespace Json;
 
-    os.precision(6);
-
-    Document doc = Load(is);
-
-    const map<string, Node> &root = doc.GetRoot().AsMap();
-
     const vector<Node> &base_requests = root.at("base_requests"s).AsArray();
 
     for (const Node &node : base_requests)
     {
-        const map<string, Node> &req = node.AsMap();
-        const string &type = req.at("type"s).AsString();
+        const RequestFields req = DecodeRequest(node.AsMap());
 
-        if (type == "Stop")
+        switch (req.type)
+        {
+        case RequestType::Stop:
         {
             StopPtr stop = ParseAddStopQuery(req, db);
             auto [it, inserted] = db.stops.insert(stop);
@@ -516,147 +679,240 @@ void Parse(istream &is, ostream &os, DataBase &db)
                 it->get()->latitude = stop->latitude;
                 it->get()->longitude = stop->longitude;
             }
+            break;
         }
-        else if (type == "Bus")
-        {
-            BusPtr bus = ParseAddBusQuery(req, db.stops);
-            db.buses.insert(bus);
+        case RequestType::Bus:
+            db.buses.insert(ParseAddBusQuery(req, db.stops));
+            break;
+        default:
+            break;
         }
     }
 
     db.sorted_stops = { db.stops.begin(), db.stops.end() };
 
-    const map<string, Node> &routing_settings = root.at("routing_settings"s).AsMap();
-    const size_t bus_wait_time = routing_settings.at("bus_wait_time"s).AsInt();
-    const double bus_velocity = routing_settings.at("bus_velocity"s).AsDouble();
+    optional<size_t> bus_wait_time;
+    optional<double> bus_velocity;
+    for (const auto &[key, value] : root.at("routing_settings"s).AsMap())
+    {
+        switch (ToField(key))
+        {
+        case Field::BusWaitTime:
+            bus_wait_time = value.AsInt();
+            break;
+        case Field::BusVelocity:
+            bus_velocity = value.AsDouble();
+            break;
+        default:
+            break;
+        }
+    }
 
     const map<string, Node> &render_settings_json = root.at("render_settings"s).AsMap();
 
-    db.CreateInfo(bus_wait_time, bus_velocity, MakeRenderSettigs(render_settings_json));
+    db.CreateInfo(Required(bus_wait_time, "bus_wait_time"), Required(bus_velocity, "bus_velocity"),
+                  MakeRenderSettigs(render_settings_json));
+}
 
-    Router router{db.graph};
+// Печатает поля total_time и items ответа на запрос Route, indent — отступ полей
+static void PrintRouteAnswer(const RouteQueryAnswer &answer, const DataBase &db, const string &indent, ostream &os)
+{
+    os << indent << "\"total_time\": " << answer.total_time << ",\n";
 
-    const vector<Node> &stat_requests = root.at("stat_requests"s).AsArray();
+    os << indent << "\"items\": [" << '\n';
+    for (auto it = answer.items.begin(); it != answer.items.end(); ++it)
+    {
+        os << indent << "    {\n";
 
-    os << "[" << '\n';
+        if (const WaitItem *item = get_if<WaitItem>(&(*it)); item != nullptr)
+        {
+            os << indent << "        \"time\": " << db.routing_settings.bus_wait_time << ",\n";
+            os << indent << "        \"type\": \"Wait\"" << ",\n";
+            os << indent << "        \"stop_name\": \"" << item->stop->name << "\"" << "\n";
+        }
+        else if (const BusItem *item = get_if<BusItem>(&(*it)); item != nullptr)
+        {
+            os << indent << "        \"span_count\": "  << item->span_count << ",\n";
+            os << indent << "        \"bus\": \""       << item->bus->name << "\"" << ",\n";
+            os << indent << "        \"type\": \"Bus\"" << ",\n";
+            os << indent << "        \"time\": "        << item->time << "\n";
+        }
 
-    for (auto it = stat_requests.begin(); it != stat_requests.end(); ++it)
-    {
-        const map<string, Node> &req = it->AsMap();
-        const string &type = req.at("type"s).AsString();
-        int id = req.at("id"s).AsInt();
+        if (next(it) != answer.items.end())
+            os << indent << "    },\n";
+        else
+            os << indent << "    }\n";
+    }
+    os << indent << "]" << '\n';
+}
 
-        os << "  {" << '\n';
+void PrintStatResponse(const map<string, Json::Node> &req, DataBase &db, Router &router, ostream &os)
+{
+    PROFILE_SCOPE("PrintStatResponse");
+    using namespace Json;
 
-        os << "    \"request_id\": " << id << ",\n";
+    const RequestFields fields = DecodeRequest(req);
+    const int id = Required(fields.id, "id");
 
-        if (type == "Bus")
-        {
-            const string &name = req.at("name"s).AsString();
-            auto bus = make_shared<Bus>(Bus{});
-            bus->name = name;
+    os << "  {" << '\n';
 
-            if (auto it = db.buses_info.find(bus); it != db.buses_info.end())
-            {
-                auto &info = it->second;
-                os << "    \"stop_count\": "        << info.stops_on_route    << ",\n"
-                   << "    \"unique_stop_count\": " << info.unique_stops      << ",\n"
-                   << "    \"route_length\": "      << info.route_length_road << ",\n"
-                   << "    \"curvature\": "         << info.curvature()       << "\n";
-            }
-            else
-                os << "    \"error_message\": \"not found\"" << '\n';
-        }
-        else if (type == "Stop")
-        {
-            const string &name = req.at("name"s).AsString();
-            auto stop = make_shared<Stop>(Stop{});
-            stop->name = name;
+    os << "    \"request_id\": " << id << ",\n";
 
-            if (auto it = db.stops.find(stop); it != db.stops.end())
-            {
-                const StopPtr &stop = *it;
-                if (not stop->buses.empty())
-                {
-                    os << "    \"buses\": [" << '\n';
-
-                    for (auto it_bus = stop->buses.begin();
-                         it_bus != stop->buses.end();
-                         ++it_bus)
-                    {
-                        os << "      \"" << it_bus->lock()->name << '\"';
-                        if (next(it_bus) != stop->buses.end())
-                            os << ',';
-                        os << '\n';
-                    }
-
-                    os << "    ]" << '\n';
-                }
-                else
-                    os << "    \"buses\": []" << '\n';
-            }
-            else
-                os << "    \"error_message\": \"not found\"" << '\n';
-        }
-        else if (type == "Route")
-        {
-            const string &from_name = req.at("from"s).AsString();
-            auto stop_from = make_shared<Stop>(Stop{});
-            stop_from->name = from_name;
+    auto print_prepared = [&os](const DataBase::Responses &responses, const string &name)
+    {
+        if (auto it = responses.find(name); it != responses.end())
+            os.write(it->second.data(), it->second.size());
+        else
+            os << "    \"error_message\": \"not found\"" << '\n';
+    };
 
-            const string &to_name = req.at("to"s).AsString();
-            auto stop_to = make_shared<Stop>(Stop{});
-            stop_to->name = to_name;
+    switch (fields.type)
+    {
+    case RequestType::Bus:
+        print_prepared(db.bus_responses, Required(fields.name, "name"));
+        break;
+    case RequestType::Stop:
+        print_prepared(db.stop_responses, Required(fields.name, "name"));
+        break;
+    case RequestType::Route:
+    {
+        const string &from_name = Required(fields.from, "from");
+        auto stop_from = make_shared<Stop>(Stop{});
+        stop_from->name = from_name;
 
-            std::optional<RouteQueryAnswer> answer = ParseRouteQuery(stop_from, stop_to, db, router);
+        const string &to_name = Required(fields.to, "to");
+        auto stop_to = make_shared<Stop>(Stop{});
+        stop_to->name = to_name;
+
+        if (fields.pareto.value_or(false))
+        {
+            const vector<RouteQueryAnswer> answers = FindParetoRoutes(db.transit, stop_from, stop_to);
 
-            if (not answer)
+            if (answers.empty())
                 os << "    \"error_message\": \"not found\"\n";
             else
             {
-                os << "    \"total_time\": " << answer->total_time << ",\n";
-
-                os << "    \"items\": [" << '\n';
-                for (auto it = answer->items.begin(); it != answer->items.end(); ++it)
+                os << "    \"routes\": [" << '\n';
+                for (auto it = answers.begin(); it != answers.end(); ++it)
                 {
                     os << "        {\n";
-
-                    if (WaitItem *item = get_if<WaitItem>(&(*it)); item != nullptr)
-                    {
-                        os << "            \"time\": " << db.routing_settings.bus_wait_time << ",\n";
-                        os << "            \"type\": \"Wait\"" << ",\n";
-                        os << "            \"stop_name\": \"" << item->stop->name << "\"" << "\n";
-                    }
-                    else if (BusItem *item = get_if<BusItem>(&(*it)); item != nullptr)
-                    {
-                        os << "            \"span_count\": "  << item->span_count << ",\n";
-                        os << "            \"bus\": \""       << item->bus->name << "\"" << ",\n";
-                        os << "            \"type\": \"Bus\"" << ",\n";
-                        os << "            \"time\": "        << item->time << "\n";
-                    }
-
-                    if (next(it) != answer->items.end())
-                        os << "        },\n";
-                    else
-                        os << "        }\n";
+                    PrintRouteAnswer(*it, db, "            ", os);
+                    os << (next(it) != answers.end() ? "        },\n" : "        }\n");
                 }
                 os << "    ]" << '\n';
             }
+            break;
         }
-        else if (type == "Map")
+
+        std::optional<RouteQueryAnswer> answer = ParseRouteQuery(stop_from, stop_to, db, router);
+
+        if (not answer)
+            os << "    \"error_message\": \"not found\"\n";
+        else
+            PrintRouteAnswer(*answer, db, "    ", os);
+        break;
+    }
+    case RequestType::Map:
+        if (db.map_svg.empty())
         {
-            if (db.map_svg.empty())
-            {
-                db.map_svg = CreateMap(db);
-            }
-            os << "    \"map\": \"" << db.map_svg << "\"\n";
+            db.map_svg = CreateMap(db);
         }
+        os << "    \"map\": \"" << db.map_svg << "\"\n";
+        break;
+    default:
+        break;
+    }
+
+    os << "  }";
+}
+
+void PrintMemoryReport(const DataBase &db, const Router *router, ostream &os)
+{
+    if (router == nullptr)
+        PrintMemoryReport(db, static_cast<const Graph::MemoryUsage *>(nullptr), os);
+    else
+    {
+        const Graph::MemoryUsage router_cache = router->GetCacheMemoryUsage();
+        PrintMemoryReport(db, &router_cache, os);
+    }
+}
+
+void PrintMemoryReport(const DataBase &db, const Graph::MemoryUsage *router_cache, ostream &os)
+{
+    size_t total_bytes = 0U;
+
+    auto print_usage = [&os, &total_bytes](string_view name, const Graph::MemoryUsage &usage)
+    {
+        os << "\"" << name << "\": {\"bytes\": " << usage.bytes
+           << ", \"allocations\": " << usage.allocations << "}";
+        total_bytes += usage.bytes;
+    };
+
+    os << "{";
+    for (size_t i = 0U; i < static_cast<size_t>(MemoryTag::TagsCount); ++i)
+    {
+        const MemoryCounter &counter = memory_counters[i];
+        const int64_t bytes = counter.bytes.load(memory_order_relaxed);
+
+        os << "\"" << MemoryTagNames[i] << "\": {\"bytes\": " << bytes
+           << ", \"peak_bytes\": " << counter.peak_bytes.load(memory_order_relaxed)
+           << ", \"allocations\": " << counter.allocations.load(memory_order_relaxed)
+           << ", \"total_allocations\": " << counter.total_allocations.load(memory_order_relaxed)
+           << "}, ";
+        total_bytes += static_cast<size_t>(max<int64_t>(bytes, 0));
+    }
+
+    print_usage("graph", db.graph.GetMemoryUsage());
+    if (router_cache != nullptr)
+    {
+        os << ", ";
+        print_usage("router_cache", *router_cache);
+    }
+
+    os << ", \"total_bytes\": " << total_bytes << "}";
+}
+
+void Parse(istream &is, ostream &os, DataBase &db, ostream *memory_report)
+{
+    const string input{istreambuf_iterator<char>(is), istreambuf_iterator<char>()};
+    Parse(string_view(input), os, db, memory_report);
+}
+
+void Parse(string_view input, ostream &os, DataBase &db, ostream *memory_report)
+{
+    using namespace Json;
+
+    os.precision(6);
+
+    PROFILE_SCOPE("Parse");
+
+    Document doc = [&input]()
+    {
+        PROFILE_SCOPE("LoadParallel");
+        return LoadParallel(input);
+    }();
+
+    const map<string, Node> &root = doc.GetRoot().AsMap();
+
+    BuildDataBase(root, db);
+
+    Router router{db.graph, db.compact_route_cache ? Graph::TreeCache::Compact : Graph::TreeCache::Full};
+
+    const vector<Node> &stat_requests = root.at("stat_requests"s).AsArray();
+
+    os << "[" << '\n';
+
+    for (auto it = stat_requests.begin(); it != stat_requests.end(); ++it)
+    {
+        PrintStatResponse(it->AsMap(), db, router, os);
 
-        os << "  }";
         if (next(it) != stat_requests.end())
             os << ',';
         os << '\n';
     }
 
     os << "]";
+
+    if (memory_report != nullptr)
+        PrintMemoryReport(db, &router, *memory_report);
 }
\ No newline at end of file
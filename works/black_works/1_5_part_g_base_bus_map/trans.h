@@ -6,6 +6,7 @@
 #include "router.h"
 #include "svg.h"
 #include "render.h"
+#include "trans_fields.h"
 
 #include <vector>
 #include <string>
@@ -28,6 +29,7 @@
 #include <ctime>
 #include <cmath>
 #include <istream>
+#include <iterator>
 #include <variant>
 #include <tuple>
 #include <bitset>
@@ -40,5 +42,21 @@ double CalcGeoDistance(double lat1, double lon1, double lat2, double lon2);
 
 StopPtr ParseAddStopQuery(const map<string, Json::Node> &req, DataBase &db);
 BusPtr ParseAddBusQuery(const map<string, Json::Node> &req, Stops &stops);
+StopPtr ParseAddStopQuery(const RequestFields &req, DataBase &db);
+BusPtr ParseAddBusQuery(const RequestFields &req, Stops &stops);
 std::optional<RouteQueryAnswer> ParseRouteQuery(StopPtr from, StopPtr to, DataBase &db, Router &router);
-void Parse(istream &is, ostream &os, DataBase &db);
\ No newline at end of file
+// Заполняет базу по base_requests, routing_settings и render_settings
+void BuildDataBase(const map<string, Json::Node> &root, DataBase &db);
+// Печатает ответ на один запрос из stat_requests в виде JSON объекта "  { ... }"
+void PrintStatResponse(const map<string, Json::Node> &req, DataBase &db, Router &router, ostream &os);
+// Печатает в одну строку JSON объект с занятой памятью по структурам базы.
+// Контейнеры базы считаются аллокатором, граф и кэши маршрутизатора оцениваются по ёмкостям.
+// Счётчики аллокатора общие для процесса, поэтому при нескольких базах суммируются
+void PrintMemoryReport(const DataBase &db, const Router *router, ostream &os);
+// То же с уже посчитанной памятью кэшей маршрутизаторов, например нескольких потоков
+void PrintMemoryReport(const DataBase &db, const Graph::MemoryUsage *router_cache, ostream &os);
+// Если memory_report не равен nullptr, после ответов туда печатается отчёт о памяти
+void Parse(istream &is, ostream &os, DataBase &db, ostream *memory_report = nullptr);
+// То же для уже загруженного в память входа, например отображённого файла.
+// Буфер должен жить до конца вызова
+void Parse(string_view input, ostream &os, DataBase &db, ostream *memory_report = nullptr);
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include "trans_types.h"
 #include "render_types.h"
+#include "pareto_router.h"
+
+#include <chrono>
 
 struct DataBase
 {
@@ -30,31 +33,80 @@ struct DataBase
 
     RenderSettings render_settings{};
 
-    template <typename Key, typename Value>
-    using UnorderedMap = unordered_map<Key, Value, NamePtrHasher<Key>, NamePtrKeyEqual<Key>>;
+    // Tag задаёт строку отчёта о памяти, в которую попадут выделения контейнера
+    template <typename Key, typename Value, MemoryTag Tag>
+    using UnorderedMap = unordered_map<Key, Value, NamePtrHasher<Key>, NamePtrKeyEqual<Key>,
+                                       CountingAllocator<pair<const Key, Value>, Tag>>;
+
+    template <typename Key, typename Value, MemoryTag Tag>
+    using IdMap = unordered_map<Key, Value, hash<Key>, equal_to<Key>,
+                                CountingAllocator<pair<const Key, Value>, Tag>>;
 
-    UnorderedMap<BusPtr, BusInfo> buses_info;
-    UnorderedMap<StopPtr, UnorderedMap<StopPtr, size_t>> road_route_length; // в метрах
+    UnorderedMap<BusPtr, BusInfo, MemoryTag::BusesInfo> buses_info;
+    // в метрах
+    UnorderedMap<StopPtr, UnorderedMap<StopPtr, size_t, MemoryTag::RoadRouteLength>, MemoryTag::RoadRouteLength>
+        road_route_length;
 
     DirectedWeightedGraph graph{0};
 
+    // В компактном режиме CreateGraph не добавляет рёбра кольцевых маршрутов, которые
+    // не могут оказаться на кратчайшем пути или дублируют путь того же веса через
+    // абстрактную остановку. Время ответов не меняется, но номера рёбер сдвигаются, и из
+    // маршрутов с одинаковым временем может быть выбран другой автобус, поэтому режим
+    // включается явно. Задаётся до CreateInfo
+    bool compact_graph = false;
+
+    // Размер графа после CreateGraph и сколько рёбер пропущено компактным режимом
+    struct GraphStats
+    {
+        size_t vertex_count = 0U;
+        size_t edge_count = 0U;
+        size_t skipped_edge_count = 0U;
+    } graph_stats{};
+
+    // Маршрутизатор, который строят Parse и сервер, хранит деревья кратчайших путей
+    // в компактном виде: 4 байта на вершину вместо 24. Ответы не меняются
+    bool compact_route_cache = false;
+
     string map_svg;
 
+    // Готовые тела ответов на запросы Bus и Stop: всё, что печатается после "request_id".
+    // Заполняются один раз при построении базы, после чего ответ на запрос —
+    // это поиск по имени и копирование строки
+    using ResponseString = basic_string<char, char_traits<char>, CountingAllocator<char, MemoryTag::Responses>>;
+    using Responses = IdMap<string, ResponseString, MemoryTag::Responses>;
+
+    Responses bus_responses;
+    Responses stop_responses;
+
     void CreateInfo(size_t bus_wait_time = 0U, double bus_velocity = 0.0, RenderSettings rs = {}, bool output = false);
 
+    // Длительности этапов последнего вызова CreateInfo, используются бенчмарком
+    struct BuildTimings
+    {
+        chrono::nanoseconds info{};      // статистика маршрутов и вершины дорожных единиц
+        chrono::nanoseconds responses{}; // CreateResponses
+        chrono::nanoseconds graph{};     // CreateGraph
+    } build_timings{};
+
     // Дорожная единица представляет из себя структуру, в которой содержится
     // остановка, маршрут и номер остановки в этом маршруте. Комбинации этих трёх состовляющих
     // достаточно, чтобы задать уникальную вершину без возникновения конфликтов с другими вершинами
     // Сигнатура: [stop][bus][position_in_bus] = vertex_id
-    UnorderedMap<StopPtr, UnorderedMap<BusPtr, unordered_map<size_t, Graph::VertexId>>> route_unit_to_vertex_id;
+    UnorderedMap<StopPtr,
+                 UnorderedMap<BusPtr, IdMap<size_t, Graph::VertexId, MemoryTag::VertexMaps>, MemoryTag::VertexMaps>,
+                 MemoryTag::VertexMaps> route_unit_to_vertex_id;
     // Сигнатура: vertex_id = [stop][bus][position_in_bus]
-    unordered_map<Graph::VertexId, tuple<StopPtr, BusPtr, size_t>> vertex_id_to_route_unit;
+    IdMap<Graph::VertexId, tuple<StopPtr, BusPtr, size_t>, MemoryTag::VertexMaps> vertex_id_to_route_unit;
 
     // Для переходов между разными маршрутами автобусов были добавлены
     // специальные вершины, которые символизируют конкретную остановку внезависимости
     // от маршрута и следующей остановки и являются так наызваюемым абстрактными остановками
-    UnorderedMap<StopPtr, Graph::VertexId> abstract_stop_to_vertex_id;
-    unordered_map<Graph::VertexId, StopPtr> vertex_id_to_abstract_stop;
+    UnorderedMap<StopPtr, Graph::VertexId, MemoryTag::VertexMaps> abstract_stop_to_vertex_id;
+    IdMap<Graph::VertexId, StopPtr, MemoryTag::VertexMaps> vertex_id_to_abstract_stop;
+
+    // Маршруты в виде массивов для поиска Парето-оптимальных по времени и числу пересадок путей
+    TransitIndex transit;
 
 private:
     Graph::VertexId _vertex_id = 0U;
@@ -65,4 +117,8 @@ private:
     std::optional<size_t> CalcRoadDistance(const StopPtr &lhs, const StopPtr &rhs) const;
 
     void CreateGraph(bool debug = false);
+
+    void CreateTransitIndex();
+
+    void CreateResponses();
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "trans_fields.h"
+
+using namespace std;
+
+// Хеш выбирает единственного кандидата, а сравнение строк отсекает
+// неизвестные ключи с тем же хешем
+#define KEY_CASE(literal, value) \
+    case KeyHash(literal):       \
+        return s == literal ? value : not_found;
+
+RequestType ToRequestType(string_view s)
+{
+    static constexpr RequestType not_found = RequestType::Unknown;
+
+    switch (KeyHash(s))
+    {
+        KEY_CASE("Stop", RequestType::Stop)
+        KEY_CASE("Bus", RequestType::Bus)
+        KEY_CASE("Route", RequestType::Route)
+        KEY_CASE("Map", RequestType::Map)
+    default:
+        return not_found;
+    }
+}
+
+Field ToField(string_view s)
+{
+    static constexpr Field not_found = Field::Unknown;
+
+    switch (KeyHash(s))
+    {
+        KEY_CASE("type", Field::Type)
+        KEY_CASE("name", Field::Name)
+        KEY_CASE("id", Field::Id)
+        KEY_CASE("latitude", Field::Latitude)
+        KEY_CASE("longitude", Field::Longitude)
+        KEY_CASE("road_distances", Field::RoadDistances)
+        KEY_CASE("stops", Field::Stops)
+        KEY_CASE("is_roundtrip", Field::IsRoundtrip)
+        KEY_CASE("from", Field::From)
+        KEY_CASE("to", Field::To)
+        KEY_CASE("pareto", Field::Pareto)
+        KEY_CASE("bus_wait_time", Field::BusWaitTime)
+        KEY_CASE("bus_velocity", Field::BusVelocity)
+        KEY_CASE("width", Field::Width)
+        KEY_CASE("height", Field::Height)
+        KEY_CASE("padding", Field::Padding)
+        KEY_CASE("stop_radius", Field::StopRadius)
+        KEY_CASE("line_width", Field::LineWidth)
+        KEY_CASE("stop_label_font_size", Field::StopLabelFontSize)
+        KEY_CASE("stop_label_offset", Field::StopLabelOffset)
+        KEY_CASE("underlayer_color", Field::UnderlayerColor)
+        KEY_CASE("underlayer_width", Field::UnderlayerWidth)
+        KEY_CASE("color_palette", Field::ColorPalette)
+    default:
+        return not_found;
+    }
+}
+
+#undef KEY_CASE
+
+RequestFields DecodeRequest(const map<string, Json::Node> &req)
+{
+    RequestFields result{};
+
+    for (const auto &[key, value] : req)
+    {
+        switch (ToField(key))
+        {
+        case Field::Type:
+            result.type = ToRequestType(value.AsString());
+            break;
+        case Field::Name:
+            result.name = &value.AsString();
+            break;
+        case Field::Id:
+            result.id = value.AsInt();
+            break;
+        case Field::Latitude:
+            result.latitude = value.AsDouble();
+            break;
+        case Field::Longitude:
+            result.longitude = value.AsDouble();
+            break;
+        case Field::RoadDistances:
+            result.road_distances = &value.AsMap();
+            break;
+        case Field::Stops:
+            result.stops = &value.AsArray();
+            break;
+        case Field::IsRoundtrip:
+            result.is_roundtrip = value.AsBool();
+            break;
+        case Field::From:
+            result.from = &value.AsString();
+            break;
+        case Field::To:
+            result.to = &value.AsString();
+            break;
+        case Field::Pareto:
+            result.pareto = value.AsBool();
+            break;
+        default:
+            break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "json.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// FNV-1a. Для строковых литералов вычисляется на этапе компиляции, поэтому
+// ключи можно использовать как метки case. Совпадение хешей двух ключей
+// одного switch приводит к ошибке компиляции (повторяющаяся метка case)
+constexpr uint64_t KeyHash(std::string_view s)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : s)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+enum class RequestType
+{
+    Unknown,
+    Stop,
+    Bus,
+    Route,
+    Map
+};
+
+// Все ключи, которые встречаются в запросах и настройках
+enum class Field
+{
+    Unknown,
+    Type,
+    Name,
+    Id,
+    Latitude,
+    Longitude,
+    RoadDistances,
+    Stops,
+    IsRoundtrip,
+    From,
+    To,
+    Pareto,
+    BusWaitTime,
+    BusVelocity,
+    Width,
+    Height,
+    Padding,
+    StopRadius,
+    LineWidth,
+    StopLabelFontSize,
+    StopLabelOffset,
+    UnderlayerColor,
+    UnderlayerWidth,
+    ColorPalette
+};
+
+RequestType ToRequestType(std::string_view s);
+Field ToField(std::string_view s);
+
+// Поля запросов из base_requests и stat_requests, собранные за один проход по словарю.
+// Указатели ссылаются на узлы исходного документа
+struct RequestFields
+{
+    RequestType type = RequestType::Unknown;
+    const std::string *name = nullptr;
+    std::optional<int> id;
+
+    // Stop
+    std::optional<double> latitude;
+    std::optional<double> longitude;
+    const std::map<std::string, Json::Node> *road_distances = nullptr;
+
+    // Bus
+    const std::vector<Json::Node> *stops = nullptr;
+    std::optional<bool> is_roundtrip;
+
+    // Route
+    const std::string *from = nullptr;
+    const std::string *to = nullptr;
+    std::optional<bool> pareto;
+};
+
+RequestFields DecodeRequest(const std::map<std::string, Json::Node> &req);
+
+// Бросает std::out_of_range, как и map::at, если обязательного поля нет
+template <typename T>
+const T &Required(const T *value, std::string_view field)
+{
+    if (value == nullptr)
+        throw std::out_of_range("Missing field " + std::string(field));
+    return *value;
+}
+
+template <typename T>
+T Required(const std::optional<T> &value, std::string_view field)
+{
+    if (not value)
+        throw std::out_of_range("Missing field " + std::string(field));
+    return *value;
+}
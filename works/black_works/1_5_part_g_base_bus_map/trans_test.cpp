@@ -1,6 +1,9 @@
 #include "trans_test.h"
 #include "test_runner.h"
 #include "profile.h"
+#include "file_io.h"
+#include "server.h"
+#include <cstdio>
 #include <fstream>
 
 using namespace std;
@@ -1501,6 +1504,255 @@ void TestBuildRoute()
     }
 }
 
+void TestRouterQueues()
+{
+    ifstream input("src/long.json");
+    ostringstream oss;
+    DataBase db;
+    Parse(input, oss, db);
+
+    Graph::Router<Weight, Graph::BinaryHeapQueue> binary_router{db.graph};
+    Graph::Router<Weight, Graph::QuaternaryHeapQueue> quaternary_router{db.graph};
+    Graph::Router<Weight, Graph::RadixHeapQueue> radix_router{db.graph};
+
+    const size_t vertex_count = db.graph.GetVertexCount();
+    const size_t step = max<size_t>(vertex_count / 7U, 1U);
+    for (Graph::VertexId from = 0U; from < vertex_count; from += step)
+    {
+        for (Graph::VertexId to = 0U; to < vertex_count; to += step / 3U + 1U)
+        {
+            const auto expect = binary_router.BuildRoute(from, to);
+            const auto quaternary = quaternary_router.BuildRoute(from, to);
+            const auto radix = radix_router.BuildRoute(from, to);
+
+            ASSERT_EQUAL(expect.has_value(), quaternary.has_value());
+            ASSERT_EQUAL(expect.has_value(), radix.has_value());
+            if (expect)
+            {
+                // при равных по времени вариантах очереди могут выбрать разные рёбра
+                ASSERT(AssertDouble(expect->weight, quaternary->weight));
+                ASSERT(AssertDouble(expect->weight, radix->weight));
+            }
+        }
+    }
+}
+
+void TestSearchWorkspace()
+{
+    {
+        Graph::SearchWorkspace<Weight, Graph::RadixHeapQueue> workspace;
+        workspace.Reset(3U);
+        workspace.Set(1U, 2.5, 7U);
+        ASSERT_EQUAL(workspace.GetDistance(1U), 2.5);
+        ASSERT_EQUAL(workspace.GetPrevEdge(1U), 7U);
+
+        // новое поколение делает старые значения недействительными без заполнения массивов
+        workspace.Reset(3U);
+        ASSERT_EQUAL(workspace.GetDistance(1U), numeric_limits<Weight>::max());
+    }
+    {
+        // поиск без кэша деревьев в памяти потока находит те же маршруты, что и с кэшем
+        ifstream input("src/long.json");
+        ostringstream oss;
+        DataBase db;
+        Parse(input, oss, db);
+
+        Router cached_router{db.graph};
+        Router uncached_router{db.graph, Graph::TreeCache::Disabled};
+
+        vector<Graph::EdgeId> expect;
+        vector<Graph::EdgeId> edges;
+        const size_t vertex_count = db.graph.GetVertexCount();
+        for (Graph::VertexId from = 0U; from < vertex_count; from += 97U)
+        {
+            for (Graph::VertexId to = 5U; to < vertex_count; to += 61U)
+            {
+                const optional<Weight> expect_weight = cached_router.BuildRoute(from, to, expect);
+                const optional<Weight> weight = uncached_router.BuildRoute(from, to, edges);
+
+                ASSERT_EQUAL(expect_weight.has_value(), weight.has_value());
+                ASSERT_EQUAL(expect, edges);
+                if (expect_weight)
+                    ASSERT_EQUAL(*expect_weight, *weight);
+            }
+        }
+        // только пустые хеш-таблицы кэшей
+        ASSERT_EQUAL(uncached_router.GetCacheMemoryUsage().allocations, 3U);
+    }
+}
+
+void TestCompactRouteCache()
+{
+    // ответы с компактным кэшем деревьев совпадают побитово, включая total_time
+    for (const char *path : {"src/long.json", "src/test15failed.json", "src/render_example_0.json",
+                             "src/render_example_1.json", "src/render_example_2.json"})
+    {
+        string outputs[2];
+        for (bool compact : {false, true})
+        {
+            ifstream input(path);
+            ostringstream oss;
+            DataBase db;
+            db.compact_route_cache = compact;
+            Parse(input, oss, db);
+            outputs[compact] = oss.str();
+        }
+        ASSERT_EQUAL(outputs[true], outputs[false]);
+    }
+    {
+        ifstream input("src/long.json");
+        ostringstream oss;
+        DataBase db;
+        Parse(input, oss, db);
+
+        Router full_router{db.graph, Graph::TreeCache::Full};
+        Router compact_router{db.graph, Graph::TreeCache::Compact};
+
+        vector<Graph::EdgeId> expect;
+        vector<Graph::EdgeId> edges;
+        const size_t vertex_count = db.graph.GetVertexCount();
+        for (Graph::VertexId from = 0U; from < vertex_count; from += 31U)
+        {
+            for (Graph::VertexId to = 0U; to < vertex_count; to += 97U)
+            {
+                const optional<Weight> expect_weight = full_router.BuildRoute(from, to, expect);
+                const optional<Weight> weight = compact_router.BuildRoute(from, to, edges);
+                ASSERT_EQUAL(expect_weight.has_value(), weight.has_value());
+                ASSERT_EQUAL(expect, edges);
+                if (expect_weight)
+                    ASSERT_EQUAL(*expect_weight, *weight);
+            }
+        }
+
+        ASSERT(compact_router.GetCacheMemoryUsage().bytes * 5U < full_router.GetCacheMemoryUsage().bytes);
+    }
+}
+
+void TestCompactGraph()
+{
+    for (const char *path : {"src/long.json", "src/test15failed.json", "src/render_example_1.json"})
+    {
+        DataBase full_db;
+        DataBase compact_db;
+        compact_db.compact_graph = true;
+
+        // ответы на запросы из файлов совпадают побитово
+        string outputs[2];
+        for (DataBase *db : {&full_db, &compact_db})
+        {
+            ifstream input(path);
+            ostringstream oss;
+            Parse(input, oss, *db);
+            outputs[db->compact_graph] = oss.str();
+        }
+        ASSERT_EQUAL(outputs[true], outputs[false]);
+
+        ASSERT_EQUAL(compact_db.graph.GetVertexCount(), full_db.graph.GetVertexCount());
+        ASSERT_EQUAL(full_db.graph_stats.skipped_edge_count, 0U);
+        ASSERT_EQUAL(compact_db.graph.GetEdgeCount() + compact_db.graph_stats.skipped_edge_count,
+                     full_db.graph.GetEdgeCount());
+
+        Router full_router{full_db.graph};
+        Router compact_router{compact_db.graph};
+
+        // для остальных пар остановок гарантировано только время: номера рёбер в графах
+        // разные, и из равных по времени маршрутов может быть выбран другой автобус
+        const vector<StopPtr> stops{full_db.sorted_stops.begin(), full_db.sorted_stops.end()};
+        for (size_t i = 0U; i < stops.size(); i += 3U)
+        {
+            for (size_t j = 1U; j < stops.size(); j += 5U)
+            {
+                const optional<RouteQueryAnswer> expect = ParseRouteQuery(stops[i], stops[j], full_db, full_router);
+                const optional<RouteQueryAnswer> answer = ParseRouteQuery(stops[i], stops[j], compact_db, compact_router);
+
+                ASSERT_EQUAL(expect.has_value(), answer.has_value());
+                if (expect)
+                    ASSERT(AssertDouble(expect->total_time, answer->total_time));
+            }
+        }
+    }
+}
+
+void TestParetoRoutes()
+{
+    {
+        StopPtr stop_a = make_shared<Stop>(Stop{"A"});
+        StopPtr stop_b = make_shared<Stop>(Stop{"B"});
+        StopPtr stop_c = make_shared<Stop>(Stop{"C"});
+        StopPtr stop_d = make_shared<Stop>(Stop{"D"});
+
+        // прямой, но медленный автобус и быстрый путь с пересадкой на C
+        BusPtr bus1 = make_shared<Bus>(Bus{"1", {stop_a, stop_b, stop_d}});
+        BusPtr bus2 = make_shared<Bus>(Bus{"2", {stop_a, stop_c}});
+        BusPtr bus3 = make_shared<Bus>(Bus{"3", {stop_c, stop_d}});
+
+        DataBase db;
+        db.stops = {stop_a, stop_b, stop_c, stop_d};
+        db.buses = {bus1, bus2, bus3};
+
+        db.road_route_length[stop_a][stop_b] = 10000;
+        db.road_route_length[stop_b][stop_a] = 10000;
+        db.road_route_length[stop_b][stop_d] = 10000;
+        db.road_route_length[stop_d][stop_b] = 10000;
+        db.road_route_length[stop_a][stop_c] = 1000;
+        db.road_route_length[stop_c][stop_a] = 1000;
+        db.road_route_length[stop_c][stop_d] = 1000;
+        db.road_route_length[stop_d][stop_c] = 1000;
+
+        db.CreateInfo(6/*bus_wait_time*/, 40.0/*bus_velocity km/hour*/);
+
+        const vector<RouteQueryAnswer> routes = FindParetoRoutes(db.transit, stop_a, stop_d);
+        ASSERT_EQUAL(routes.size(), 2U);
+
+        ASSERT(AssertDouble(routes[0].total_time, 36.0));
+        ASSERT_EQUAL(routes[0].items.size(), 2U);
+        ASSERT_EQUAL(get<WaitItem>(routes[0].items[0]).stop->name, "A"s);
+        ASSERT_EQUAL(get<BusItem>(routes[0].items[1]).bus->name, "1"s);
+        ASSERT_EQUAL(get<BusItem>(routes[0].items[1]).span_count, 2U);
+
+        ASSERT(AssertDouble(routes[1].total_time, 15.0));
+        ASSERT_EQUAL(routes[1].items.size(), 4U);
+        ASSERT_EQUAL(get<BusItem>(routes[1].items[1]).bus->name, "2"s);
+        ASSERT_EQUAL(get<WaitItem>(routes[1].items[2]).stop->name, "C"s);
+        ASSERT_EQUAL(get<BusItem>(routes[1].items[3]).bus->name, "3"s);
+        ASSERT(AssertDouble(get<BusItem>(routes[1].items[3]).time, 1.5));
+
+        // обратно по некольцевым маршрутам
+        ASSERT_EQUAL(FindParetoRoutes(db.transit, stop_d, stop_a).size(), 2U);
+        ASSERT_EQUAL(FindParetoRoutes(db.transit, stop_a, stop_a).size(), 1U);
+        ASSERT(FindParetoRoutes(db.transit, stop_a, make_shared<Stop>(Stop{"E"})).empty());
+    }
+    {
+        // самый быстрый из Парето-оптимальных совпадает с ответом обычного запроса Route
+        ifstream input("src/long.json");
+        ostringstream oss;
+        DataBase db;
+        Parse(input, oss, db);
+        Router router{db.graph};
+
+        const vector<StopPtr> stops{db.sorted_stops.begin(), db.sorted_stops.end()};
+        for (size_t i = 0U; i < stops.size(); i += 7U)
+        {
+            for (size_t j = 3U; j < stops.size(); j += 11U)
+            {
+                const optional<RouteQueryAnswer> expect = ParseRouteQuery(stops[i], stops[j], db, router);
+                const vector<RouteQueryAnswer> routes = FindParetoRoutes(db.transit, stops[i], stops[j]);
+
+                ASSERT_EQUAL(expect.has_value(), not routes.empty());
+                if (not expect)
+                    continue;
+                ASSERT(AssertDouble(routes.back().total_time, expect->total_time));
+
+                for (size_t k = 1U; k < routes.size(); ++k)
+                {
+                    ASSERT(routes[k].items.size() > routes[k - 1U].items.size());
+                    ASSERT(routes[k].total_time < routes[k - 1U].total_time);
+                }
+            }
+        }
+    }
+}
+
 void TestParseJson()
 {
     istringstream input(R"({
@@ -2037,6 +2289,90 @@ void TestParseJson()
     }
 }
 
+void TestLoadParallel()
+{
+    using namespace Json;
+    {
+        const string input = R"([ {"a": [1, 2, {"b": "x,]}"}]}, "s, [t]" , 3.5,true,[] ])";
+        const vector<string_view> elements = SplitArrayElements(input);
+        ASSERT_EQUAL(elements.size(), 5U);
+        ASSERT_EQUAL(elements[0], R"( {"a": [1, 2, {"b": "x,]}"}]})"sv);
+        ASSERT_EQUAL(elements[1], R"( "s, [t]" )"sv);
+        ASSERT_EQUAL(elements[2], " 3.5"sv);
+        ASSERT_EQUAL(elements[3], "true"sv);
+        ASSERT_EQUAL(elements[4], "[] "sv);
+    }
+    {
+        ASSERT(SplitArrayElements("[ ]").empty());
+    }
+    {
+        ifstream input("src/long.json");
+        const string data{istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+        istringstream iss(data);
+
+        Document expect = Load(iss);
+        for (size_t threads_count : {1U, 2U, 7U})
+        {
+            Document doc = LoadParallel(data, threads_count);
+            ASSERT(doc.GetRoot() == expect.GetRoot());
+        }
+    }
+}
+
+void TestDecodeRequest()
+{
+    using namespace Json;
+    {
+        ASSERT(ToRequestType("Bus") == RequestType::Bus);
+        ASSERT(ToRequestType("Map") == RequestType::Map);
+        ASSERT(ToRequestType("Bu") == RequestType::Unknown);
+        ASSERT(ToField("stop_label_font_size") == Field::StopLabelFontSize);
+        ASSERT(ToField("bus_velocity") == Field::BusVelocity);
+        ASSERT(ToField("") == Field::Unknown);
+        ASSERT(ToField("Name") == Field::Unknown);
+    }
+    {
+        istringstream iss(R"({"type": "Route", "from": "A", "to": "B", "id": 4, "extra": 1})");
+        Document doc = Load(iss);
+        const RequestFields req = DecodeRequest(doc.GetRoot().AsMap());
+        ASSERT(req.type == RequestType::Route);
+        ASSERT_EQUAL(Required(req.id, "id"), 4);
+        ASSERT_EQUAL(Required(req.from, "from"), "A"s);
+        ASSERT_EQUAL(Required(req.to, "to"), "B"s);
+        ASSERT(req.name == nullptr);
+        ASSERT(not req.is_roundtrip);
+    }
+}
+
+void TestMemoryReport()
+{
+    {
+        const MemoryCounter &counter = GetMemoryCounter(MemoryTag::Stops);
+        const int64_t bytes_before = counter.bytes.load();
+        const int64_t allocations_before = counter.allocations.load();
+        {
+            Stops stops{MakeStop(Stop{"Universam"}), MakeStop(Stop{"Biryusinka"})};
+            ASSERT(counter.bytes.load() >= bytes_before + 2 * static_cast<int64_t>(sizeof(Stop)));
+            ASSERT(counter.allocations.load() >= allocations_before + 4);
+        }
+        ASSERT_EQUAL(counter.bytes.load(), bytes_before);
+        ASSERT_EQUAL(counter.allocations.load(), allocations_before);
+    }
+    {
+        ifstream input("src/render_example_0.json");
+        ostringstream oss;
+        ostringstream report;
+        DataBase db;
+        Parse(input, oss, db, &report);
+
+        const string result = report.str();
+        for (string_view name : MemoryTagNames)
+            ASSERT(result.find("\""s + string(name) + "\": {\"bytes\": ") != string::npos);
+        ASSERT(result.find("\"router_cache\"") != string::npos);
+        ASSERT(db.graph.GetMemoryUsage().bytes >= db.graph.GetEdgeCount() * sizeof(Edge));
+    }
+}
+
 void TestParse()
 {
     {
@@ -4192,4 +4528,168 @@ void TestRender2()
     ostringstream oss;
     DataBase db;
     Parse(input, oss, db);
+}
+
+// Ответ на long.json побайтно совпадает с сохранённым эталоном: изменения маршрутизатора
+// не должны менять выбор между маршрутами с одинаковым временем
+void TestLongExpected()
+{
+    ifstream input("src/long.json");
+    ifstream expected_input("src/long_expected.json", ios::binary);
+    ASSERT(input.is_open());
+    ASSERT(expected_input.is_open());
+    const string expected{istreambuf_iterator<char>(expected_input), istreambuf_iterator<char>()};
+
+    ostringstream oss;
+    DataBase db;
+    Parse(input, oss, db);
+    ASSERT(oss.str() == expected);
+}
+
+// Содержимое временного файла, позиция записи остаётся в конце
+static string ReadTempFile(FILE *file)
+{
+    fflush(file);
+    rewind(file);
+    string result = ReadAll(file);
+    fseek(file, 0, SEEK_END);
+    return result;
+}
+
+void TestMappedFile()
+{
+    const string path = "test_mapped_file.txt";
+    {
+        ofstream output(path, ios::binary);
+        output << "{\"base_requests\": []}\n";
+    }
+    {
+        const MappedFile file(path);
+        ASSERT_EQUAL(file.Data(), "{\"base_requests\": []}\n"sv);
+    }
+
+    // пустой файл не отображается, а читается
+    {
+        ofstream output(path, ios::binary | ios::trunc);
+    }
+    {
+        const MappedFile file(path);
+        ASSERT(file.Data().empty());
+    }
+    remove(path.c_str());
+
+    try
+    {
+        MappedFile file("test_mapped_file_missing.txt");
+        ASSERT(false);
+    }
+    catch (runtime_error &)
+    {
+    }
+}
+
+void TestReadAll()
+{
+    static constexpr size_t BlockSize = 1U << 20U;
+
+    // пустой вход, ровно блок и больше блока
+    for (size_t size : {size_t{0U}, BlockSize, BlockSize * 2U + 7U})
+    {
+        string content(size, '\0');
+        for (size_t i = 0U; i < size; ++i)
+            content[i] = static_cast<char>('a' + i % 26U);
+
+        FILE *file = tmpfile();
+        ASSERT(file != nullptr);
+        fwrite(content.data(), 1U, content.size(), file);
+        rewind(file);
+        ASSERT(ReadAll(file) == content);
+        fclose(file);
+    }
+}
+
+void TestOutputBuffer()
+{
+    FILE *file = tmpfile();
+    ASSERT(file != nullptr);
+    {
+        OutputBuffer buffer(file, 8U);
+        ostream os(&buffer);
+
+        // помещается в буфер — в файл ничего не пишется
+        os.write("abcde", 5);
+        ASSERT_EQUAL(ReadTempFile(file), ""s);
+
+        // не помещается в остаток — накопленное сбрасывается, блок копируется в буфер
+        os.write("fghij", 5);
+        ASSERT_EQUAL(ReadTempFile(file), "abcde"s);
+
+        // не меньше всего буфера — накопленное сбрасывается, блок пишется напрямую
+        os.write("0123456789", 10);
+        ASSERT_EQUAL(ReadTempFile(file), "abcdefghij0123456789"s);
+        // блок размером с буфер, когда в буфере уже что-то есть
+        os.write("xyz", 3);
+        os.write("01234567", 8);
+        ASSERT_EQUAL(ReadTempFile(file), "abcdefghij0123456789xyz01234567"s);
+
+        // посимвольная запись: девятый символ переполняет буфер
+        for (char c : "ABCDEFGHI"sv)
+            os.put(c);
+        ASSERT_EQUAL(ReadTempFile(file), "abcdefghij0123456789xyz01234567ABCDEFGH"s);
+
+        os.flush();
+        ASSERT_EQUAL(ReadTempFile(file), "abcdefghij0123456789xyz01234567ABCDEFGHI"s);
+
+        os << "tail";
+    }
+    // остаток дописывает деструктор
+    ASSERT_EQUAL(ReadTempFile(file), "abcdefghij0123456789xyz01234567ABCDEFGHItail"s);
+    fclose(file);
+}
+
+void TestParseFromView()
+{
+    string expected;
+    {
+        ifstream input("src/long.json");
+        ostringstream oss;
+        DataBase db;
+        Parse(input, oss, db);
+        expected = oss.str();
+    }
+
+    const MappedFile input("src/long.json");
+    ostringstream oss;
+    DataBase db;
+    Parse(input.Data(), oss, db);
+    ASSERT(oss.str() == expected);
+}
+
+void TestServerOptions()
+{
+    auto parse = [](vector<string> args)
+    {
+        args.insert(args.begin(), "white");
+        vector<char *> argv;
+        for (string &arg : args)
+            argv.push_back(arg.data());
+        return ParseServerOptions(static_cast<int>(argv.size()), argv.data());
+    };
+
+    const ServerOptions options = parse({"--input", "src/long.json", "--compact-graph"});
+    ASSERT(not options.serve);
+    ASSERT_EQUAL(options.input_path, "src/long.json"s);
+    ASSERT(options.compact_graph);
+
+    ASSERT(parse({"--serve", "--base", "src/long.json"}).serve);
+
+    // база сервера задаётся только через --base
+    try
+    {
+        parse({"--serve", "--base", "src/long.json", "--input", "src/long.json"});
+        ASSERT(false);
+    }
+    catch (invalid_argument &)
+    {
+    }
 }
\ No newline at end of file
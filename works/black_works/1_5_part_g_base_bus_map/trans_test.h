@@ -10,10 +10,24 @@ void TestDataBaseCreateGraph();
 void TestMakeRenderSettigs();
 void TestCreateMap();
 void TestBuildRoute();
+void TestRouterQueues();
+void TestSearchWorkspace();
+void TestCompactRouteCache();
+void TestCompactGraph();
+void TestParetoRoutes();
 void TestParseJson();
+void TestLoadParallel();
+void TestDecodeRequest();
+void TestMemoryReport();
 void TestParse();
 void TestParseRouteQuery();
 void Test15();
 void TestRender0();
 void TestRender1();
-void TestRender2();
\ No newline at end of file
+void TestRender2();
+void TestLongExpected();
+void TestMappedFile();
+void TestReadAll();
+void TestOutputBuffer();
+void TestParseFromView();
+void TestServerOptions();
\ No newline at end of file
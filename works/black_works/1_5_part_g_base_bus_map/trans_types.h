@@ -1,6 +1,7 @@
 #pragma once
 #include "graph.h"
 #include "router.h"
+#include "counting_allocator.h"
 
 #include <vector>
 #include <string>
@@ -77,7 +78,7 @@ struct NameWeakPtrKeyLess
 struct Bus;
 using BusPtr = shared_ptr<Bus>;
 using BusWeakPtr = weak_ptr<Bus>;
-using BusesSorted = set<BusWeakPtr, NameWeakPtrKeyLess<BusWeakPtr>>;
+using BusesSorted = set<BusWeakPtr, NameWeakPtrKeyLess<BusWeakPtr>, CountingAllocator<BusWeakPtr, MemoryTag::Stops>>;
 
 struct Stop
 {
@@ -91,19 +92,36 @@ struct Stop
 };
 using StopPtr = shared_ptr<Stop>;
 using StopsSorted = set<StopPtr, NamePtrKeyLess<StopPtr>>;
+using BusStops = vector<StopPtr, CountingAllocator<StopPtr, MemoryTag::Buses>>;
 
 struct Bus
 {
     string name;
-    vector<StopPtr> stops;
+    BusStops stops;
     bool ring = false;
 
     bool operator==(const Bus &o) const
     { return name == o.name; }
 };
 
-using Stops = unordered_set<StopPtr, NamePtrHasher<StopPtr>, NamePtrKeyEqual<StopPtr>>;
-using Buses = unordered_set<BusPtr, NamePtrHasher<BusPtr>, NamePtrKeyEqual<BusPtr>>;
+using Stops = unordered_set<StopPtr, NamePtrHasher<StopPtr>, NamePtrKeyEqual<StopPtr>,
+                           CountingAllocator<StopPtr, MemoryTag::Stops>>;
+using Buses = unordered_set<BusPtr, NamePtrHasher<BusPtr>, NamePtrKeyEqual<BusPtr>,
+                            CountingAllocator<BusPtr, MemoryTag::Buses>>;
+
+// Остановки и маршруты базы выделяются через учитывающий аллокатор,
+// чтобы сами объекты попадали в отчёт о памяти вместе с контейнерами
+template <typename... Args>
+StopPtr MakeStop(Args &&...args)
+{
+    return allocate_shared<Stop>(CountingAllocator<Stop, MemoryTag::Stops>{}, forward<Args>(args)...);
+}
+
+template <typename... Args>
+BusPtr MakeBus(Args &&...args)
+{
+    return allocate_shared<Bus>(CountingAllocator<Bus, MemoryTag::Buses>{}, forward<Args>(args)...);
+}
 
 using Weight = double;
 using DirectedWeightedGraph = Graph::DirectedWeightedGraph<Weight>;
@@ -21,6 +21,11 @@
 #include <stdexcept>
 #include <ctime>
 #include <cmath>
+#include <charconv>
+#include <string_view>
+#include <system_error>
+#include <iterator>
+#include <chrono>
 
 using namespace std;
 
@@ -211,6 +216,84 @@ private:
     }
 };
 
+string_view Trim(string_view s)
+{
+    while (not s.empty() and (s.front() == ' ' or s.front() == '\t'))
+        s.remove_prefix(1);
+    while (not s.empty() and (s.back() == ' ' or s.back() == '\t' or s.back() == '\r'))
+        s.remove_suffix(1);
+    return s;
+}
+
+template <typename Number>
+Number ParseNumber(string_view s)
+{
+    Number result{};
+    const char *end = s.data() + s.size();
+    auto [ptr, ec] = from_chars(s.data(), end, result);
+    if (ec != errc{} or ptr != end)
+        throw invalid_argument("Invalid number: " + string(s));
+    return result;
+}
+
+// Делит строку запроса на токены без копирования: каждый токен -- string_view
+// на исходный буфер без пробелов по краям
+class LineTokenizer
+{
+public:
+    explicit LineTokenizer(string_view line)
+        : _rest(line)
+    {
+    }
+
+    bool Empty() const
+    { return Trim(_rest).empty(); }
+
+    // Возвращает токен до разделителя и пропускает сам разделитель.
+    // Если разделителя нет, то возвращается весь остаток строки
+    string_view Next(char separator)
+    {
+        const size_t pos = _rest.find(separator);
+        const string_view token = _rest.substr(0U, pos);
+        _rest.remove_prefix(pos == string_view::npos ? _rest.size() : pos + 1U);
+        return Trim(token);
+    }
+
+    string_view Rest() const
+    { return _rest; }
+
+private:
+    string_view _rest;
+};
+
+// Выдаёт непустые строки буфера по одной
+class LineReader
+{
+public:
+    explicit LineReader(string_view buffer)
+        : _rest(buffer)
+    {
+    }
+
+    optional<string_view> Next()
+    {
+        while (not _rest.empty())
+        {
+            const size_t pos = _rest.find('\n');
+            string_view line = _rest.substr(0U, pos);
+            _rest.remove_prefix(pos == string_view::npos ? _rest.size() : pos + 1U);
+            if (not line.empty() and line.back() == '\r')
+                line.remove_suffix(1U);
+            if (not Trim(line).empty())
+                return line;
+        }
+        return nullopt;
+    }
+
+private:
+    string_view _rest;
+};
+
 // X: latitude, longitude
 StopPtr ParseAddStopQuery(istream &is, DataBase &db)
 {
@@ -333,23 +416,126 @@ BusPtr ParseAddBusQuery(istream &is, Stops &stops)
     return result;
 }
 
+// То же, что ParseAddStopQuery(istream&), но разбирает готовую строку без промежуточных строк.
+// line -- всё, что идёт после слова "Stop"
+StopPtr ParseAddStopQuery(string_view line, DataBase &db)
+{
+    LineTokenizer tokenizer(line);
+    StopPtr result = make_shared<Stop>();
+
+    result->name = string(tokenizer.Next(':'));
+    result->latitude = ParseNumber<double>(tokenizer.Next(','));
+    result->longitude = ParseNumber<double>(tokenizer.Next(','));
+
+    if (tokenizer.Empty())
+        return result;
+
+    // parse D[i]m to stop#
+    auto &road_route_length = db.road_route_length[result];
+
+    while (not tokenizer.Empty())
+    {
+        LineTokenizer distance(tokenizer.Next(','));
+
+        const size_t meters = ParseNumber<size_t>(distance.Next('m'));
+
+        const string_view rest = Trim(distance.Rest());
+        static constexpr string_view To = "to ";
+        if (rest.substr(0U, To.size()) != To)
+            throw runtime_error("Expected 'to'");
+
+        auto [it_stop, inserted] = db.stops.insert(make_shared<Stop>(Stop{ string(Trim(rest.substr(To.size()))) }));
+
+        road_route_length[*it_stop] = meters;
+
+        auto &road_route_length_rhs = db.road_route_length[*it_stop];
+
+        if (auto it = road_route_length_rhs.find(result);
+            it == road_route_length_rhs.end())
+        {
+            road_route_length_rhs[result] = meters;
+        }
+    }
+
+    return result;
+}
+
+// То же, что ParseAddBusQuery(istream&, Stops&), line -- всё, что идёт после слова "Bus"
+BusPtr ParseAddBusQuery(string_view line, Stops &stops)
+{
+    LineTokenizer tokenizer(line);
+    BusPtr result = make_shared<Bus>();
+
+    result->name = string(tokenizer.Next(':'));
+
+    const string_view route = tokenizer.Rest();
+    const size_t separator_pos = route.find_first_of("->");
+    const char separator = separator_pos == string_view::npos ? '-' : route[separator_pos];
+    result->ring = separator == '>';
+
+    auto push_stop = [&stops, &result](string_view name)
+    {
+        StopPtr stop = make_shared<Stop>(Stop{ string(name) });
+        auto [it, inserted] = stops.insert(stop);
+        result->stops.push_back(*it);
+        it->get()->buses.insert(result);
+    };
+
+    while (not tokenizer.Empty())
+    {
+        const string_view stop_name = tokenizer.Next(separator);
+
+        // последнюю остановку не надо добавлять
+        // для кольцевого маршрута
+        if (result->ring and tokenizer.Empty())
+            break;
+
+        push_stop(stop_name);
+    }
+    return result;
+}
+
 void Parse(istream &is, ostream &os)
 {
     DataBase db{};
 
     os.precision(6);
 
-    size_t data_base_requests_count = 0U;
-    is >> data_base_requests_count;
+    const string input{istreambuf_iterator<char>(is), istreambuf_iterator<char>()};
+    LineReader lines(input);
+
+    auto next_line = [&lines]()
+    {
+        optional<string_view> line = lines.Next();
+        if (not line)
+            throw runtime_error("Unexpected end of input");
+        return *line;
+    };
+
+    // первое слово строки и всё, что идёт после него
+    auto split_command = [](string_view line)
+    {
+        line = Trim(line);
+        const size_t pos = line.find(' ');
+        const string_view command = line.substr(0U, pos);
+        line.remove_prefix(pos == string_view::npos ? line.size() : pos + 1U);
+        return make_pair(command, line);
+    };
+
+    // пустой вход -- пустая база без запросов
+    const optional<string_view> first_line = lines.Next();
+    if (not first_line)
+        return;
+
+    const size_t data_base_requests_count = ParseNumber<size_t>(Trim(*first_line));
 
     for (size_t i = 0U; i < data_base_requests_count; ++i)
     {
-        string first_word;
-        is >> first_word;
+        const auto [first_word, query] = split_command(next_line());
 
         if (first_word == "Stop")
         {
-            StopPtr stop = ParseAddStopQuery(is, db);
+            StopPtr stop = ParseAddStopQuery(query, db);
             auto [it, inserted] = db.stops.insert(stop);
             if (not inserted)
             {
@@ -359,26 +545,23 @@ void Parse(istream &is, ostream &os)
         }
         else if (first_word == "Bus")
         {
-            BusPtr bus = ParseAddBusQuery(is, db.stops);
+            BusPtr bus = ParseAddBusQuery(query, db.stops);
             db.buses.insert(move(bus));
         }
     }
 
     db.CreateBusesInfo();
 
-    size_t requests_count = 0U;
-    is >> requests_count;
+    const size_t requests_count = ParseNumber<size_t>(Trim(next_line()));
 
     for (size_t i = 0U; i < requests_count; ++i)
     {
-        string request;
-        is >> request;
-        is.ignore(1); // ignore space
+        const auto [request, name] = split_command(next_line());
 
         if (request == "Bus")
         {
             auto bus = make_shared<Bus>(Bus{});
-            getline(is, bus->name);
+            bus->name = string(name);
 
             os << "Bus " << bus->name << ": ";
 
@@ -396,7 +579,7 @@ void Parse(istream &is, ostream &os)
         else if (request == "Stop")
         {
             auto stop = make_shared<Stop>(Stop{});
-            getline(is, stop->name);
+            stop->name = string(name);
 
             os << "Stop " << stop->name << ": ";
 
@@ -591,6 +774,73 @@ void TestParseAddBusQuery()
     }
 }
 
+void TestLineTokenizer()
+{
+    {
+        LineTokenizer tokenizer("  Univer  : 21.666, 89.591 ,3900m to Marushkino");
+        ASSERT_EQUAL(tokenizer.Next(':'), "Univer"sv);
+        ASSERT_EQUAL(ParseNumber<double>(tokenizer.Next(',')), 21.666);
+        ASSERT_EQUAL(ParseNumber<double>(tokenizer.Next(',')), 89.591);
+        ASSERT_EQUAL(tokenizer.Next(','), "3900m to Marushkino"sv);
+        ASSERT(tokenizer.Empty());
+    }
+    {
+        bool thrown = false;
+        try
+        {
+            ParseNumber<double>("21.6x");
+        }
+        catch (invalid_argument &)
+        {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    {
+        LineReader lines("3\r\n\n  \nStop A: 1, 2\nBus 1");
+        ASSERT_EQUAL(*lines.Next(), "3"sv);
+        ASSERT_EQUAL(*lines.Next(), "Stop A: 1, 2"sv);
+        ASSERT_EQUAL(*lines.Next(), "Bus 1"sv);
+        ASSERT(not lines.Next());
+    }
+    // строковые версии разбора дают тот же результат, что и потоковые
+    for (const string &line : {
+             " Empire   Street Building 5: 55.611087, 2.34"s,
+             " Univer: 21.666, 89.591, 3900m to Marushkino, 1000m to Sabotajnaya, 100000m to Meteornaya"s})
+    {
+        DataBase db_stream;
+        istringstream is(line);
+        StopPtr expect = ParseAddStopQuery(is, db_stream);
+
+        DataBase db;
+        StopPtr stop = ParseAddStopQuery(string_view(line), db);
+        ASSERT_EQUAL(stop->name, expect->name);
+        ASSERT_EQUAL(stop->latitude, expect->latitude);
+        ASSERT_EQUAL(stop->longitude, expect->longitude);
+        ASSERT_EQUAL(db.stops.size(), db_stream.stops.size());
+        ASSERT_EQUAL(db.road_route_length.size(), db_stream.road_route_length.size());
+        for (const auto &[from, distances] : db_stream.road_route_length)
+            for (const auto &[to, meters] : distances)
+                ASSERT_EQUAL(db.road_route_length.at(from).at(to), meters);
+    }
+    for (const string &line : {
+             " 256: Biryulyovo  Zapadnoye - Biryusinka - Universam - Biryulyovo  Tovarnaya"s,
+             " 750: Tolstopaltsevo > Marushkino > Rasskazovka > Tolstopaltsevo"s})
+    {
+        Stops stops_stream;
+        istringstream is(line);
+        BusPtr expect = ParseAddBusQuery(is, stops_stream);
+
+        Stops stops;
+        BusPtr bus = ParseAddBusQuery(string_view(line), stops);
+        ASSERT_EQUAL(bus->name, expect->name);
+        ASSERT_EQUAL(bus->ring, expect->ring);
+        ASSERT_EQUAL(bus->stops.size(), expect->stops.size());
+        for (size_t i = 0U; i < bus->stops.size(); ++i)
+            ASSERT_EQUAL(bus->stops[i]->name, expect->stops[i]->name);
+    }
+}
+
 void TestCalcGeoDistance()
 {
     {
@@ -963,18 +1213,170 @@ void TestAll()
     TestRunner tr{};
     RUN_TEST(tr, TestParseAddStopQuery);
     RUN_TEST(tr, TestParseAddBusQuery);
+    RUN_TEST(tr, TestLineTokenizer);
     RUN_TEST(tr, TestCalcGeoDistance);
     RUN_TEST(tr, TestDataBaseCreateBusesInfo);
     RUN_TEST(tr, TestParse);
 }
 
+// Сравнение разбора базы через istream и через LineTokenizer на миллионе строк
 void Profile()
 {
+    static constexpr size_t StopsCount = 10'000U;
+    static constexpr size_t LinesCount = 1'000'000U;
+    static constexpr size_t StopsPerBus = 6U;
+
+    mt19937 random(42U);
+    auto stop_name = [&random]()
+    { return "Stop number " + to_string(random() % StopsCount); };
+
+    string input = to_string(LinesCount) + "\n";
+    for (size_t i = 0U; i < LinesCount; ++i)
+    {
+        if (i % 2U == 0U)
+        {
+            input += "Stop " + stop_name() + ": 55." + to_string(random() % 1000000U) + ", 37." +
+                to_string(random() % 1000000U) + ", " + to_string(random() % 5000U + 1U) + "m to " +
+                stop_name() + ", " + to_string(random() % 5000U + 1U) + "m to " + stop_name() + "\n";
+        }
+        else
+        {
+            input += "Bus " + to_string(i) + ": " + stop_name();
+            for (size_t j = 1U; j < StopsPerBus; ++j)
+                input += " - " + stop_name();
+            input += "\n";
+        }
+    }
+
+    auto report = [&input](const string &name, chrono::steady_clock::duration duration)
+    {
+        const double seconds = chrono::duration<double>(duration).count();
+        cerr << name << ": " << seconds * 1000.0 << " ms, "
+             << LinesCount / seconds / 1e6 << " M lines/s, "
+             << input.size() / seconds / (1024.0 * 1024.0) << " MB/s" << endl;
+    };
+
+    // только разбор строк: время определяется токенизатором, а не заполнением базы.
+    // Контрольная сумма не даёт компилятору выбросить разбор
+    {
+        istringstream is(input);
+        const auto start = chrono::steady_clock::now();
+
+        double checksum = 0.0;
+        size_t count = 0U;
+        is >> count;
+        string line, s;
+        for (size_t i = 0U; i < count; ++i)
+        {
+            string first_word;
+            is >> first_word;
+            getline(is, line);
+            istringstream iss(line);
+            getline(iss, s, ':');
+            checksum += s.size();
+            if (first_word == "Stop")
+            {
+                getline(iss, s, ',');
+                checksum += stod(s);
+                getline(iss, s, ',');
+                checksum += stod(s);
+                while (iss >> s)
+                {
+                    checksum += stoi(s);
+                    iss >> s; // to
+                    iss.ignore(1);
+                    getline(iss, s, ',');
+                    checksum += s.size();
+                }
+            }
+            else
+            {
+                while (getline(iss, s, '-'))
+                    checksum += s.size();
+            }
+        }
+
+        report("istream tokens (checksum " + to_string(checksum) + ")", chrono::steady_clock::now() - start);
+    }
+    {
+        const auto start = chrono::steady_clock::now();
+
+        double checksum = 0.0;
+        LineReader lines(input);
+        const size_t count = ParseNumber<size_t>(*lines.Next());
+        for (size_t i = 0U; i < count; ++i)
+        {
+            LineTokenizer tokenizer(*lines.Next());
+            const string_view first_word = tokenizer.Next(' ');
+            checksum += tokenizer.Next(':').size();
+            if (first_word == "Stop")
+            {
+                checksum += ParseNumber<double>(tokenizer.Next(','));
+                checksum += ParseNumber<double>(tokenizer.Next(','));
+                while (not tokenizer.Empty())
+                {
+                    LineTokenizer distance(tokenizer.Next(','));
+                    checksum += ParseNumber<size_t>(distance.Next('m'));
+                    checksum += Trim(distance.Rest()).size() - 3U; // "to "
+                }
+            }
+            else
+            {
+                while (not tokenizer.Empty())
+                    checksum += tokenizer.Next('-').size();
+            }
+        }
+
+        report("LineTokenizer tokens (checksum " + to_string(checksum) + ")", chrono::steady_clock::now() - start);
+    }
+
+    // полный разбор с заполнением DataBase. Здесь время почти целиком уходит на хеш-таблицы
+    // и множества базы, а второй замер заметно страдает от кучи, оставшейся после первой базы,
+    // поэтому сравнивать токенизаторы стоит по замерам выше
+    {
+        DataBase db;
+        istringstream is(input);
+        const auto start = chrono::steady_clock::now();
+
+        size_t count = 0U;
+        is >> count;
+        for (size_t i = 0U; i < count; ++i)
+        {
+            string first_word;
+            is >> first_word;
+            if (first_word == "Stop")
+                db.stops.insert(ParseAddStopQuery(is, db));
+            else
+                db.buses.insert(ParseAddBusQuery(is, db.stops));
+        }
+
+        report("istream + DataBase", chrono::steady_clock::now() - start);
+    }
+    {
+        DataBase db;
+        const auto start = chrono::steady_clock::now();
+
+        LineReader lines(input);
+        const size_t count = ParseNumber<size_t>(*lines.Next());
+        for (size_t i = 0U; i < count; ++i)
+        {
+            LineTokenizer tokenizer(*lines.Next());
+            if (tokenizer.Next(' ') == "Stop")
+                db.stops.insert(ParseAddStopQuery(tokenizer.Rest(), db));
+            else
+                db.buses.insert(ParseAddBusQuery(tokenizer.Rest(), db.stops));
+        }
+
+        report("LineTokenizer + DataBase", chrono::steady_clock::now() - start);
+    }
 }
 
 int main()
 {
     TestAll();
+#if defined(PROFILE_TOKENIZER)
+    Profile();
+#endif
 
     Parse(cin, cout);
     return 0;
@@ -1,5 +1,6 @@
 #include "stats.h"
-#include <vector>
+#include <algorithm>
+#include <array>
 
 Stats::Stats()
 {
@@ -45,36 +46,43 @@ const map<string_view, int> &Stats::GetUriStats() const
     return _uri_stats;
 }
 
-vector<string_view> SplitIntoWords(string_view line)
+namespace
 {
-    vector<string_view> result;
 
+// Вызывает func для каждого куска line между одиночными пробелами, без выделения памяти
+template <typename Func>
+void ForEachWord(string_view line, Func func)
+{
     while (true)
     {
-        size_t space = line.find(' ');
-        result.push_back(line.substr(0, space));
+        const size_t space = line.find(' ');
+        func(line.substr(0, space));
         if (space == line.npos)
         {
             break;
         }
-        else
-        {
-            line.remove_prefix(space + 1);
-        }
+        line.remove_prefix(space + 1);
     }
-    return result;
 }
 
+} // namespace
+
 HttpRequest ParseRequest(string_view line)
 {
-    static constexpr size_t MethodPos = 0U;
-    static constexpr size_t UriPos = 1U;
-    static constexpr size_t ProtocolPos = 2U;
+    static constexpr size_t WordsCount = 3U; // метод, адрес, протокол
 
     size_t not_space_pos = line.find_first_not_of(' ');
-    line = line.substr(not_space_pos, line.npos);
+    line = line.substr(min(not_space_pos, line.size()), line.npos);
 
-    vector<string_view> words = SplitIntoWords(line);
+    array<string_view, WordsCount> words;
+    size_t words_count = 0U;
+    ForEachWord(line, [&](string_view word)
+    {
+        if (words_count < WordsCount)
+        {
+            words[words_count++] = word;
+        }
+    });
 
-    return {words[MethodPos], words[UriPos], words[ProtocolPos]};
-}
\ No newline at end of file
+    return {words[0], words[1], words[2]};
+}
@@ -28,37 +28,35 @@ struct Stats
     }
 };
 
-Stats ExploreLine(const set<string_view> &key_words, const string &line)
+// Вызывает func для каждого непустого куска str между пробелами, без выделения памяти
+template <typename Func>
+void ForEachWord(string_view str, Func func)
 {
-    Stats result{};
-
-    string_view str = line;
-
-    vector<string_view> words;
     while (true)
     {
-        size_t space = str.find(' ');
-        words.push_back(str.substr(0, space));
-        if (space == str.npos)
+        // пробелов между словами может быть больше одного
+        str.remove_prefix(min(str.find_first_not_of(' '), str.size()));
+        if (str.empty())
         {
             break;
         }
-        else
-        {
-            str.remove_prefix(space + 1);
-            // ищем лишние пробелы, так как их может быть больше одного
-            size_t not_space = str.find_first_not_of(' ');
-            str.remove_prefix(not_space);
-        }
+        const size_t space = str.find(' ');
+        func(str.substr(0, space));
+        str.remove_prefix(min(space, str.size()));
     }
+}
+
+Stats ExploreLine(const set<string_view> &key_words, const string &line)
+{
+    Stats result{};
 
-    for (const auto &word : words)
+    ForEachWord(line, [&](string_view word)
     {
         if (key_words.count(word))
         {
             ++result.word_frequences[string(word)];
         }
-    }
+    });
     return result;
 }
 
@@ -0,0 +1,287 @@
+#include "search_server.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Формат файла индекса. Все числа записаны в порядке байт машины, которая
+// сохранила файл, все разделы выровнены на 8 байт от начала файла:
+//
+//   FileHeader
+//   uint64_t term_begins[terms_count + 1]     — смещения слов в chars
+//   uint64_t postings_begins[terms_count + 1] — смещения списков в postings
+//   uint32_t slots[slots_count]               — хеш-таблица слов с линейным
+//                                               пробированием: номер слова + 1, 0 — пусто
+//   char chars[]                              — слова подряд, без разделителей
+//   uint8_t postings[]                        — списки документов, как в памяти
+//
+// Load проверяет заголовок, границы разделов и списки документов: запросы читают их
+// без проверок, поэтому испорченный список иначе читался бы за пределами файла
+
+namespace
+{
+
+constexpr char FileMagic[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '1'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint64_t docs_count;
+    uint64_t terms_count;
+    uint64_t slots_count;
+    uint64_t term_begins_offset;
+    uint64_t postings_begins_offset;
+    uint64_t slots_offset;
+    uint64_t chars_offset;
+    uint64_t postings_offset;
+    uint64_t file_size;
+};
+
+uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + 7U) & ~uint64_t{7U};
+}
+
+// FNV-1a
+uint64_t HashTerm(string_view word)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : word)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Читает число, записанное WriteVarint, не заходя за end. Возвращает false, если
+// число не заканчивается до end или длиннее 64 бит
+bool ReadVarintChecked(const uint8_t *&data, const uint8_t *end, uint64_t &value)
+{
+    value = 0U;
+    for (unsigned shift = 0U; data != end and shift < 64U; shift += 7U)
+    {
+        const uint64_t byte = *data++;
+        value |= (byte & 0x7FU) << shift;
+        if (byte < 0x80U)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Список — пары (разность номеров документов, число вхождений), он должен заканчиваться
+// ровно на конце пары, а номера документов — быть меньше docs_count
+bool IsValidPostings(const uint8_t *data, const uint8_t *end, uint64_t docs_count)
+{
+    uint64_t doc_id = 0U;
+    while (data != end)
+    {
+        uint64_t doc_id_delta = 0U;
+        uint64_t hits = 0U;
+        if (not ReadVarintChecked(data, end, doc_id_delta) or not ReadVarintChecked(data, end, hits)
+            or doc_id_delta >= docs_count - doc_id)
+        {
+            return false;
+        }
+        doc_id += doc_id_delta;
+    }
+    return true;
+}
+
+void WritePadding(ostream &output, uint64_t &offset)
+{
+    static constexpr char zeros[8] = {};
+    const uint64_t aligned = AlignUp(offset);
+    output.write(zeros, static_cast<streamsize>(aligned - offset));
+    offset = aligned;
+}
+
+template <typename T>
+void WriteArray(ostream &output, const vector<T> &values, uint64_t &offset)
+{
+    output.write(reinterpret_cast<const char *>(values.data()), static_cast<streamsize>(values.size() * sizeof(T)));
+    offset += values.size() * sizeof(T);
+}
+
+} // namespace
+
+void Index::Save(const string &path) const
+{
+    const size_t terms_count = TermsCount();
+
+    FileHeader header{};
+    memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.docs_count = docs_count;
+    header.terms_count = terms_count;
+
+    // таблица заполнена не больше чем наполовину
+    header.slots_count = 2U;
+    while (header.slots_count < 2U * terms_count)
+    {
+        header.slots_count *= 2U;
+    }
+
+    vector<uint64_t> term_begins(terms_count + 1U);
+    vector<uint64_t> postings_begins(terms_count + 1U);
+    vector<uint32_t> slots(header.slots_count);
+    for (TermId term = 0U; term < terms_count; ++term)
+    {
+        const string_view word = Term(term);
+        const auto [begin, end] = TermPostings(term);
+        term_begins[term + 1U] = term_begins[term] + word.size();
+        postings_begins[term + 1U] = postings_begins[term] + static_cast<uint64_t>(end - begin);
+
+        size_t slot = HashTerm(word) & (header.slots_count - 1U);
+        while (slots[slot] != 0U)
+        {
+            slot = (slot + 1U) & (header.slots_count - 1U);
+        }
+        slots[slot] = term + 1U;
+    }
+
+    header.term_begins_offset = AlignUp(sizeof(FileHeader));
+    header.postings_begins_offset = header.term_begins_offset + term_begins.size() * sizeof(uint64_t);
+    header.slots_offset = header.postings_begins_offset + postings_begins.size() * sizeof(uint64_t);
+    header.chars_offset = header.slots_offset + slots.size() * sizeof(uint32_t);
+    header.postings_offset = AlignUp(header.chars_offset + term_begins.back());
+    header.file_size = header.postings_offset + postings_begins.back();
+
+    // файл пишется рядом и подменяет старый целиком: индексы, открытые из старого
+    // файла, продолжают читать его содержимое, а не обрезанное или новое
+    const string temp_path = path + ".tmp";
+    ofstream output(temp_path, ios::binary | ios::trunc);
+    if (not output)
+    {
+        throw runtime_error("Can't create " + temp_path);
+    }
+
+    uint64_t offset = sizeof(FileHeader);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+    WritePadding(output, offset);
+    WriteArray(output, term_begins, offset);
+    WriteArray(output, postings_begins, offset);
+    WriteArray(output, slots, offset);
+    for (TermId term = 0U; term < terms_count; ++term)
+    {
+        const string_view word = Term(term);
+        output.write(word.data(), static_cast<streamsize>(word.size()));
+    }
+    offset += term_begins.back();
+    WritePadding(output, offset);
+    for (TermId term = 0U; term < terms_count; ++term)
+    {
+        const auto [begin, end] = TermPostings(term);
+        output.write(reinterpret_cast<const char *>(begin), end - begin);
+    }
+
+    output.close();
+    if (not output or rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        remove(temp_path.c_str());
+        throw runtime_error("Can't write " + path);
+    }
+}
+
+Index Index::Load(const string &path)
+{
+    auto file = make_shared<const MappedFile>(path);
+    auto corrupted = [&path]() { return runtime_error("Corrupted index file " + path); };
+
+    if (file->Size() < sizeof(FileHeader))
+    {
+        throw corrupted();
+    }
+    FileHeader header{};
+    memcpy(&header, file->Data(), sizeof(FileHeader));
+
+    // разделы идут по порядку и целиком помещаются в файл
+    const uint64_t terms_count = header.terms_count;
+    const bool valid_header =
+        memcmp(header.magic, FileMagic, sizeof(FileMagic)) == 0
+        and header.file_size == file->Size()
+        and terms_count < NoTerm
+        and header.slots_count > terms_count
+        and (header.slots_count & (header.slots_count - 1U)) == 0U
+        and header.slots_count <= header.file_size
+        and header.term_begins_offset == AlignUp(sizeof(FileHeader))
+        and header.postings_begins_offset == header.term_begins_offset + (terms_count + 1U) * sizeof(uint64_t)
+        and header.slots_offset == header.postings_begins_offset + (terms_count + 1U) * sizeof(uint64_t)
+        and header.chars_offset == header.slots_offset + header.slots_count * sizeof(uint32_t)
+        and header.chars_offset <= header.postings_offset
+        and header.postings_offset % 8U == 0U
+        and header.postings_offset <= header.file_size;
+    if (not valid_header)
+    {
+        throw corrupted();
+    }
+
+    const uint8_t *data = file->Data();
+    Index index;
+    index.docs_count = header.docs_count;
+    index._mapped.terms_count = terms_count;
+    index._mapped.term_begins = reinterpret_cast<const uint64_t *>(data + header.term_begins_offset);
+    index._mapped.postings_begins = reinterpret_cast<const uint64_t *>(data + header.postings_begins_offset);
+    index._mapped.slots = reinterpret_cast<const uint32_t *>(data + header.slots_offset);
+    index._mapped.slots_count = header.slots_count;
+    index._mapped.chars = reinterpret_cast<const char *>(data + header.chars_offset);
+    index._mapped.postings = data + header.postings_offset;
+
+    // смещения не убывают и не выходят за свои разделы
+    const MappedSections &mapped = index._mapped;
+    for (size_t term = 0U; term < terms_count; ++term)
+    {
+        if (mapped.term_begins[term] > mapped.term_begins[term + 1U]
+            or mapped.postings_begins[term] > mapped.postings_begins[term + 1U])
+        {
+            throw corrupted();
+        }
+    }
+    if (mapped.term_begins[0] != 0U or mapped.postings_begins[0] != 0U
+        or mapped.term_begins[terms_count] > header.postings_offset - header.chars_offset
+        or mapped.postings_begins[terms_count] != header.file_size - header.postings_offset)
+    {
+        throw corrupted();
+    }
+    // без пустых ячеек поиск отсутствующего слова не остановится
+    size_t empty_slots_count = 0U;
+    for (size_t slot = 0U; slot < mapped.slots_count; ++slot)
+    {
+        if (mapped.slots[slot] > terms_count)
+        {
+            throw corrupted();
+        }
+        empty_slots_count += mapped.slots[slot] == 0U ? 1U : 0U;
+    }
+    if (empty_slots_count == 0U)
+    {
+        throw corrupted();
+    }
+    for (size_t term = 0U; term < terms_count; ++term)
+    {
+        if (not IsValidPostings(mapped.postings + mapped.postings_begins[term],
+                                mapped.postings + mapped.postings_begins[term + 1U], header.docs_count))
+        {
+            throw corrupted();
+        }
+    }
+
+    index._file = move(file);
+    return index;
+}
+
+Index::TermId Index::FindMappedTerm(string_view word) const
+{
+    // Load проверил, что пустые ячейки есть, поэтому поиск остановится
+    const size_t mask = _mapped.slots_count - 1U;
+    for (size_t slot = HashTerm(word) & mask; _mapped.slots[slot] != 0U; slot = (slot + 1U) & mask)
+    {
+        const TermId term = _mapped.slots[slot] - 1U;
+        if (Term(term) == word)
+        {
+            return term;
+        }
+    }
+    return NoTerm;
+}
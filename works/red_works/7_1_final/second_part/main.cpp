@@ -2,6 +2,8 @@
 #include <test_runner.h>
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <iterator>
 #include <map>
 #include <vector>
@@ -11,20 +13,47 @@
 #include <random>
 #include <thread>
 #include <chrono>
+#include <optional>
 
 #include <fstream>
 
 #include <search_server.h>
 #include <parse.h>
+#include <tokenizer.h>
 
 using namespace std;
 using namespace std::chrono;
 
 void TestAll();
 void Profile();
+void Benchmark(size_t doc_words_count, size_t queries_count, size_t dictionary_size, size_t distinct_queries_count);
+void BenchmarkTokenizer(const vector<string> &paths);
+void CreateDocumentsAndQueriesFiles();
 
-int main()
+// white --bench [слов в документе] [число запросов] [размер словаря] [различных запросов]
+// — замер на предельных размерах; по умолчанию все запросы различны
+int main(int argc, char *argv[])
 {
+    if (argc > 1 and string_view(argv[1]) == "--bench")
+    {
+        Benchmark(argc > 2 ? stoul(argv[2]) : 100U,
+                  argc > 3 ? stoul(argv[3]) : SearchServer::MaxQueriesCount - 1U,
+                  argc > 4 ? stoul(argv[4]) : 10'000U,
+                  argc > 5 ? stoul(argv[5]) : 0U);
+        return 0;
+    }
+    // white --bench-tokenizer [файлы] — разбор строк файлов на слова разными способами;
+    // без файлов — docs.txt и queries.txt, как в Profile, они создаются, если их нет
+    if (argc > 1 and string_view(argv[1]) == "--bench-tokenizer")
+    {
+        if (argc == 2 and not ifstream("docs.txt"))
+        {
+            CreateDocumentsAndQueriesFiles();
+        }
+        BenchmarkTokenizer(argc > 2 ? vector<string>(argv + 2, argv + argc) : vector<string>{"docs.txt", "queries.txt"});
+        return 0;
+    }
+
     TestAll();
     // Profile();
     return 0;
@@ -285,6 +314,507 @@ void TestMoscow()
     TestFunctionality(docs, queries, expected);
 }
 
+// doc_id → число вхождений слова; заодно проверяет порядок обхода
+map<size_t, size_t> CollectDocs(const Index &index, string_view word)
+{
+    map<size_t, size_t> result;
+    index.ForEachDoc(word, [&result](size_t doc_id, size_t hits)
+    {
+        ASSERT(result.empty() or prev(result.end())->first < doc_id);
+        result[doc_id] = hits;
+    });
+    return result;
+}
+
+void TestIndexVocabulary()
+{
+    Index index;
+    index.Add("  a bb  a ccc ", 0U);
+    index.Add("bb dd", 1U);
+    index.docs_count = 2U;
+
+    ASSERT_EQUAL(index.TermsCount(), 4U);
+
+    // слово ищется по string_view на чужой буфер
+    const string query = "xx bb ccc a";
+    using Docs = map<size_t, size_t>;
+    ASSERT_EQUAL(CollectDocs(index, string_view(query).substr(3U, 2U)), (Docs{{0U, 1U}, {1U, 1U}}));
+    ASSERT_EQUAL(CollectDocs(index, string_view(query).substr(6U, 3U)), (Docs{{0U, 1U}}));
+    ASSERT_EQUAL(CollectDocs(index, string_view(query).substr(10U, 1U)), (Docs{{0U, 2U}}));
+    ASSERT(CollectDocs(index, "xx").empty());
+    ASSERT_EQUAL(index.FindTerm("xx"), Index::NoTerm);
+    ASSERT(index.FindTerm("a") != index.FindTerm("bb"));
+}
+
+void TestIndexPostingsEncoding()
+{
+    Index index;
+    // разности doc_id и числа вхождений, не влезающие в один байт varint
+    const string many_words = Join(' ', vector<string>(300U, "w"));
+    index.Add("w", 0U);
+    index.Add(many_words, 127U);
+    index.Add("w w", 128U);
+    index.Add("w", 328U);
+    index.Add(many_words + " v", 100'000U);
+    index.docs_count = 100'001U;
+
+    using Docs = map<size_t, size_t>;
+    ASSERT_EQUAL(CollectDocs(index, "w"), (Docs{{0U, 1U}, {127U, 300U}, {128U, 2U}, {328U, 1U}, {100'000U, 300U}}));
+    ASSERT_EQUAL(CollectDocs(index, "v"), (Docs{{100'000U, 1U}}));
+
+    try
+    {
+        index.Add("w", 100'000U);
+        ASSERT(false);
+    }
+    catch (invalid_argument &)
+    {
+    }
+}
+
+// Индекс, собранный по кускам в нескольких потоках, совпадает с собранным подряд
+void TestParallelIndexBuild()
+{
+    const size_t docs_count = SearchServer::ShardDocsCount * 5U / 2U;
+
+    vector<string> docs;
+    set<string> words;
+    for (size_t i = 0U; i < docs_count; ++i)
+    {
+        const vector<string> doc_words = {
+            "a" + to_string(i % 7U), "b" + to_string(i % 13U), "b" + to_string(i % 13U),
+            "c" + to_string(i), "d" + to_string(i / 600U)};
+        words.insert(doc_words.begin(), doc_words.end());
+        docs.push_back(Join(' ', doc_words));
+    }
+
+    Index expected;
+    for (size_t i = 0U; i < docs.size(); ++i)
+    {
+        expected.Add(docs[i], i);
+    }
+
+    istringstream docs_input(Join('\n', docs));
+    SearchServer srv(docs_input);
+    const shared_ptr<const Index> index = srv.GetSnapshot()->main;
+
+    ASSERT_EQUAL(index->docs_count, docs_count);
+    ASSERT_EQUAL(index->TermsCount(), expected.TermsCount());
+    for (const string &word : words)
+    {
+        ASSERT_EQUAL(index->FindTerm(word), expected.FindTerm(word));
+        ASSERT_EQUAL(CollectDocs(*index, word), CollectDocs(expected, word));
+    }
+}
+
+void TestThreadPool()
+{
+    vector<future<size_t>> results;
+    {
+        ThreadPool pool(3U);
+        ASSERT_EQUAL(pool.Size(), 3U);
+        for (size_t i = 0U; i < 1'000U; ++i)
+        {
+            results.push_back(pool.Submit([i]() { return i * i; }));
+        }
+
+        auto failed = pool.Submit([]() -> int { throw runtime_error("task failed"); });
+        try
+        {
+            failed.get();
+            ASSERT(false);
+        }
+        catch (runtime_error &)
+        {
+        }
+        // деструктор дорабатывает очередь
+    }
+
+    for (size_t i = 0U; i < results.size(); ++i)
+    {
+        ASSERT_EQUAL(results[i].get(), i * i);
+    }
+}
+
+// Поток из многих пачек запросов: результаты выводятся в порядке запросов
+void TestLargeQueryStream()
+{
+    const size_t docs_count = 100U;
+    const size_t queries_count = SearchServer::QueriesBatchSize * 10U + 7U;
+
+    vector<string> docs;
+    for (size_t i = 0U; i < docs_count; ++i)
+    {
+        docs.push_back("w" + to_string(i) + " common");
+    }
+    vector<string> queries;
+    for (size_t i = 0U; i < queries_count; ++i)
+    {
+        queries.push_back("w" + to_string(i % docs_count) + " missing");
+    }
+
+    istringstream docs_input(Join('\n', docs));
+    istringstream queries_input(Join('\n', queries));
+    ostringstream queries_output;
+    {
+        SearchServer srv(docs_input);
+        srv.AddQueriesStream(queries_input, queries_output);
+    }
+
+    const string result = queries_output.str();
+    const auto lines = SplitBy(Strip(result), '\n');
+    ASSERT_EQUAL(lines.size(), queries_count);
+    for (size_t i = 0U; i < queries_count; ++i)
+    {
+        const size_t doc_id = i % docs_count;
+        ASSERT_EQUAL(lines[i], queries[i] + ": {docid: " + to_string(doc_id) + ", hitcount: 1}");
+    }
+}
+
+// Добавления и удаления по одному документу дают те же ответы, что и база,
+// собранная целиком, в которой удалённые документы заменены пустыми строками
+void TestIncrementalUpdates()
+{
+    const vector<string> dictionary = {"red", "green", "blue", "cat", "dog", "fish", "one", "two"};
+    mt19937 random(7U);
+    auto random_doc = [&]()
+    {
+        vector<string> words(2U + random() % 5U);
+        for (string &word : words)
+        {
+            word = dictionary[random() % dictionary.size()];
+        }
+        return Join(' ', words);
+    };
+
+    vector<string> docs;
+    for (size_t i = 0U; i < 20U; ++i)
+    {
+        docs.push_back(random_doc());
+    }
+    istringstream docs_input(Join('\n', docs));
+    SearchServer srv(docs_input);
+
+    for (size_t i = 0U; i < 300U; ++i)
+    {
+        const string doc = random_doc();
+        ASSERT_EQUAL(srv.AddDocument(doc), docs.size());
+        docs.push_back(doc);
+
+        if (i % 3U == 0U)
+        {
+            const size_t doc_id = random() % docs.size();
+            ASSERT_EQUAL(srv.RemoveDocument(doc_id), not docs[doc_id].empty());
+            docs[doc_id].clear();
+        }
+    }
+    ASSERT(not srv.RemoveDocument(docs.size()));
+
+    srv.Wait();
+    const shared_ptr<const IndexSnapshot> snapshot = srv.GetSnapshot();
+    ASSERT_EQUAL(snapshot->docs_count, docs.size());
+    ASSERT(snapshot->deltas.size() <= SearchServer::MaxDeltaIndexes);
+    ASSERT(snapshot->main->docs_count > 20U); // дельта-индексы сливались и с основным
+
+    vector<string> queries = dictionary;
+    for (size_t i = 0U; i < 100U; ++i)
+    {
+        queries.push_back(random_doc());
+    }
+
+    auto search = [&queries](SearchServer &server)
+    {
+        istringstream queries_input(Join('\n', queries));
+        ostringstream queries_output;
+        server.AddQueriesStream(queries_input, queries_output);
+        server.Wait();
+        return queries_output.str();
+    };
+
+    // пустые документы не совпадают ни с одним запросом, но занимают свои номера
+    istringstream expected_docs_input(Join('\n', docs) + '\n');
+    SearchServer expected_srv(expected_docs_input);
+    ASSERT_EQUAL(expected_srv.GetSnapshot()->docs_count, docs.size());
+    ASSERT_EQUAL(search(srv), search(expected_srv));
+}
+
+// Сервер, открывший сохранённый индекс, отвечает так же, как собравший базу заново,
+// и после открытия в базу можно добавлять документы
+void TestIndexFile()
+{
+    const vector<string> dictionary = {"red", "green", "blue", "cat", "dog", "fish", "one", "two"};
+    mt19937 random(11U);
+    auto random_doc = [&]()
+    {
+        vector<string> words(1U + random() % 6U);
+        for (string &word : words)
+        {
+            word = dictionary[random() % dictionary.size()];
+        }
+        return Join(' ', words);
+    };
+
+    vector<string> docs;
+    for (size_t i = 0U; i < 300U; ++i)
+    {
+        docs.push_back(random_doc());
+    }
+    // не влезающие в байт varint разности и числа вхождений
+    docs[200] = Join(' ', vector<string>(300U, "cat"));
+
+    vector<string> queries = dictionary;
+    queries.push_back("unknown cat");
+    for (size_t i = 0U; i < 100U; ++i)
+    {
+        queries.push_back(random_doc());
+    }
+    auto search = [&queries](SearchServer &server)
+    {
+        istringstream queries_input(Join('\n', queries));
+        ostringstream queries_output;
+        server.AddQueriesStream(queries_input, queries_output);
+        server.Wait();
+        return queries_output.str();
+    };
+
+    const string path = "test_index.bin";
+
+    istringstream docs_input(Join('\n', docs));
+    SearchServer built_srv(docs_input);
+    built_srv.SaveIndex(path);
+
+    SearchServer loaded_srv;
+    loaded_srv.LoadIndex(path);
+    ASSERT_EQUAL(loaded_srv.GetSnapshot()->docs_count, docs.size());
+    ASSERT_EQUAL(loaded_srv.GetSnapshot()->main->TermsCount(), dictionary.size());
+    ASSERT_EQUAL(search(loaded_srv), search(built_srv));
+
+    // дельта-индексы и удаления поверх открытого индекса, со слиянием с ним
+    for (size_t i = 0U; i < 60U; ++i)
+    {
+        const string doc = random_doc() + " new";
+        ASSERT_EQUAL(built_srv.AddDocument(doc), loaded_srv.AddDocument(doc));
+        ASSERT_EQUAL(built_srv.RemoveDocument(i * 5U), loaded_srv.RemoveDocument(i * 5U));
+    }
+    queries.push_back("new");
+    ASSERT_EQUAL(search(loaded_srv), search(built_srv));
+
+    // сохранённая с удалениями база открывается с теми же ответами
+    loaded_srv.SaveIndex(path);
+    SearchServer reloaded_srv;
+    reloaded_srv.LoadIndex(path);
+    ASSERT_EQUAL(search(reloaded_srv), search(built_srv));
+
+    const string broken_path = "test_index_broken.bin";
+    {
+        ofstream broken(broken_path, ios::binary | ios::trunc);
+        broken << "not an index";
+    }
+    try
+    {
+        reloaded_srv.LoadIndex(broken_path);
+        ASSERT(false);
+    }
+    catch (runtime_error &)
+    {
+    }
+    ASSERT_EQUAL(search(reloaded_srv), search(built_srv));
+
+    // целый заголовок, но испорченные списки документов
+    built_srv.SaveIndex(path);
+    string saved;
+    {
+        ifstream saved_input(path, ios::binary);
+        saved.assign(istreambuf_iterator<char>(saved_input), istreambuf_iterator<char>());
+    }
+    auto load_broken = [&](const string &content)
+    {
+        {
+            ofstream broken(broken_path, ios::binary | ios::trunc);
+            broken << content;
+        }
+        try
+        {
+            reloaded_srv.LoadIndex(broken_path);
+            ASSERT(false);
+        }
+        catch (runtime_error &)
+        {
+        }
+        ASSERT_EQUAL(search(reloaded_srv), search(built_srv));
+    };
+    {
+        // последний список обрывается посреди числа
+        string broken = saved;
+        broken.back() = static_cast<char>(broken.back() | 0x80);
+        load_broken(broken);
+    }
+    {
+        // номера документов не меньше docs_count, который идёт в заголовке сразу за сигнатурой
+        string broken = saved;
+        const uint64_t docs_count = 1U;
+        memcpy(broken.data() + 8U, &docs_count, sizeof(docs_count));
+        load_broken(broken);
+    }
+
+    remove(path.c_str());
+    remove(broken_path.c_str());
+}
+
+// Запросы из тех же слов в другом порядке берутся из кэша,
+// а после изменения базы ответы считаются заново
+void TestQueryCache()
+{
+    ASSERT_EQUAL(QueryCache::NormalizeQuery("  b a  b "), "a b b");
+
+    istringstream docs_input(Join('\n', vector<string>{"a b", "b b", "c"}));
+    SearchServer srv(docs_input);
+
+    auto search = [&srv](const vector<string> &queries)
+    {
+        istringstream queries_input(Join('\n', queries));
+        ostringstream queries_output;
+        srv.AddQueriesStream(queries_input, queries_output);
+        srv.Wait();
+        return queries_output.str();
+    };
+
+    ASSERT_EQUAL(search({"a b", " b  a", "b a b"}),
+                 "a b: {docid: 0, hitcount: 2} {docid: 1, hitcount: 2}\n"
+                 " b  a: {docid: 0, hitcount: 2} {docid: 1, hitcount: 2}\n"
+                 "b a b: {docid: 1, hitcount: 4} {docid: 0, hitcount: 3}\n");
+    QueryCacheStats stats = srv.GetQueryCacheStats();
+    ASSERT_EQUAL(stats.hits, 1U);
+    ASSERT_EQUAL(stats.misses, 2U);
+
+    srv.AddDocument("a a a");
+    ASSERT_EQUAL(search({"b a"}), "b a: {docid: 3, hitcount: 3} {docid: 0, hitcount: 2} {docid: 1, hitcount: 2}\n");
+    srv.RemoveDocument(3U);
+    ASSERT_EQUAL(search({"a b"}), "a b: {docid: 0, hitcount: 2} {docid: 1, hitcount: 2}\n");
+    stats = srv.GetQueryCacheStats();
+    ASSERT_EQUAL(stats.hits, 1U);
+    ASSERT_EQUAL(stats.misses, 4U);
+
+    // кэш не растёт больше ёмкости
+    QueryCache cache(32U);
+    for (size_t i = 0U; i < 1'000U; ++i)
+    {
+        cache.Insert(to_string(i), "x");
+    }
+    ASSERT(cache.Size() <= 32U);
+    string result;
+    ASSERT(cache.Find("999", result));
+    ASSERT_EQUAL(result, "x");
+    ASSERT(not cache.Find("0", result));
+}
+
+// Блочный разбор совпадает с побайтовым на любых сочетаниях разделителей и длин слов,
+// в том числе на словах через границу блока
+void TestTokenizer()
+{
+    auto collect = [](string_view text, char sep, bool scalar)
+    {
+        vector<string> result;
+        auto add = [&result](string_view token) { result.emplace_back(token); };
+        scalar ? ForEachTokenScalar(text, sep, add) : ForEachToken(text, sep, add);
+        return result;
+    };
+
+    ASSERT_EQUAL(collect("  a bb  ccc ", ' ', false), (vector<string>{"a", "bb", "ccc"}));
+    ASSERT(collect("", ' ', false).empty());
+    ASSERT(collect(string(100U, ' '), ' ', false).empty());
+    ASSERT(SplitBy(string(100U, ' '), ' ').empty());
+    ASSERT_EQUAL(collect(string(100U, 'x'), ' ', false), vector<string>{string(100U, 'x')});
+    ASSERT_EQUAL(collect("a b\nc d", '\n', false), (vector<string>{"a b", "c d"}));
+
+    mt19937 random(3U);
+    for (size_t i = 0U; i < 2'000U; ++i)
+    {
+        // длинные слова и длинные пробелы встречаются только в части текстов
+        const size_t size = random() % 200U;
+        const size_t space_rate = 1U + random() % 40U;
+        string text(size, 'w');
+        for (char &c : text)
+        {
+            c = random() % space_rate == 0U ? ' ' : static_cast<char>('a' + random() % 26U);
+        }
+        ASSERT_EQUAL(collect(text, ' ', false), collect(text, ' ', true));
+    }
+}
+
+// Запросы, идущие во время обновлений, видят либо старую, либо новую базу целиком
+void TestUpdateWhileQuerying()
+{
+    const vector<string> docs_a = {"x", "x", "x"};
+    const vector<string> docs_b = {"x x y"};
+    const string expected_a = "x y: {docid: 0, hitcount: 1} {docid: 1, hitcount: 1} {docid: 2, hitcount: 1}";
+    const string expected_b = "x y: {docid: 0, hitcount: 3}";
+
+    constexpr size_t QueriesCount = 20'000U;
+    constexpr size_t UpdatesCount = 50U;
+
+    istringstream queries_input(Join('\n', vector<string>(QueriesCount, "x y")));
+    vector<istringstream> docs_inputs;
+    for (size_t i = 0U; i < UpdatesCount; ++i)
+    {
+        docs_inputs.emplace_back(Join('\n', i % 2U == 0U ? docs_b : docs_a));
+    }
+    ostringstream queries_output;
+
+    {
+        istringstream initial_docs(Join('\n', docs_a));
+        SearchServer srv(initial_docs);
+        srv.AddQueriesStream(queries_input, queries_output);
+        for (auto &docs_input : docs_inputs)
+        {
+            srv.UpdateDocumentBase(docs_input);
+        }
+        // деструктор дожидается окончания всех задач
+    }
+
+    const string result = queries_output.str();
+    const auto lines = SplitBy(Strip(result), '\n');
+    ASSERT_EQUAL(lines.size(), QueriesCount);
+    for (const string_view line : lines)
+    {
+        ASSERT(line == expected_a or line == expected_b);
+    }
+}
+
+void TestLastUpdatePublished()
+{
+    // база с номером i состоит из i + 1 документов, поэтому опубликованную видно по их числу
+    constexpr size_t UpdatesCount = 100U;
+
+    vector<istringstream> docs_inputs;
+    for (size_t i = 0U; i < UpdatesCount; ++i)
+    {
+        docs_inputs.emplace_back(Join('\n', vector<string>(i + 1U, "x")));
+    }
+
+    SearchServer srv;
+    for (auto &docs_input : docs_inputs)
+    {
+        srv.UpdateDocumentBase(docs_input);
+    }
+    srv.Wait();
+    ASSERT_EQUAL(srv.GetSnapshot()->docs_count, UpdatesCount);
+
+    // LoadIndex тоже замена базы: после неё старые обновления уже не публикуются
+    const string path = "test_last_update.idx";
+    {
+        istringstream docs_input("x\nx");
+        SearchServer saved(docs_input);
+        saved.SaveIndex(path);
+    }
+    istringstream stale_input(Join('\n', vector<string>(5U, "x")));
+    srv.UpdateDocumentBase(stale_input);
+    srv.LoadIndex(path);
+    srv.Wait();
+    ASSERT_EQUAL(srv.GetSnapshot()->docs_count, 2U);
+    remove(path.c_str());
+}
+
 void TestAll()
 {
     TestRunner tr{};
@@ -295,6 +825,17 @@ void TestAll()
     RUN_TEST(tr, TestRanking);
     RUN_TEST(tr, TestBasicSearch);
     RUN_TEST(tr, TestMoscow);
+    RUN_TEST(tr, TestIndexVocabulary);
+    RUN_TEST(tr, TestIndexPostingsEncoding);
+    RUN_TEST(tr, TestParallelIndexBuild);
+    RUN_TEST(tr, TestUpdateWhileQuerying);
+    RUN_TEST(tr, TestLastUpdatePublished);
+    RUN_TEST(tr, TestThreadPool);
+    RUN_TEST(tr, TestLargeQueryStream);
+    RUN_TEST(tr, TestIncrementalUpdates);
+    RUN_TEST(tr, TestIndexFile);
+    RUN_TEST(tr, TestQueryCache);
+    RUN_TEST(tr, TestTokenizer);
 }
 
 void CreateDocumentsAndQueriesFiles()
@@ -463,3 +1004,169 @@ void Profile()
 
     ProfileSearchServer(docs_file, queries_file, search_results_output, expected_earch_results);
 }
+
+// Случайная база из MaxDocsCount документов по словарю из dictionary_size слов
+// и поток запросов по 10 слов. Время построения индекса и обработки запросов
+// и размер индекса печатаются в cerr
+void Benchmark(size_t doc_words_count, size_t queries_count, size_t dictionary_size, size_t distinct_queries_count)
+{
+    constexpr size_t WordLength = 10U;
+    constexpr size_t QueryWordsCount = 10U;
+
+    mt19937 random(42U);
+    uniform_int_distribution<int> letter('a', 'z');
+    vector<string> words(dictionary_size);
+    for (string &word : words)
+    {
+        generate_n(back_inserter(word), WordLength, [&]() { return static_cast<char>(letter(random)); });
+    }
+
+    auto make_lines = [&](size_t lines_count, size_t line_words_count)
+    {
+        string result;
+        for (size_t i = 0U; i < lines_count; ++i)
+        {
+            for (size_t j = 0U; j < line_words_count; ++j)
+            {
+                result += words[random() % dictionary_size];
+                result += ' ';
+            }
+            result += '\n';
+        }
+        return result;
+    };
+
+    istringstream docs_input(make_lines(SearchServer::MaxDocsCount - 1U, doc_words_count));
+    string queries = make_lines(queries_count, QueryWordsCount);
+    if (distinct_queries_count > 0U)
+    {
+        // запросы повторяются, как в реальном потоке: берутся из набора различных
+        const string distinct_queries = make_lines(distinct_queries_count, QueryWordsCount);
+        const auto distinct_lines = SplitBy(distinct_queries, '\n');
+        queries.clear();
+        for (size_t i = 0U; i < queries_count; ++i)
+        {
+            queries += distinct_lines[random() % distinct_queries_count];
+            queries += '\n';
+        }
+    }
+    const string index_path = "bench_index.bin";
+
+    auto run_queries = [&queries](optional<SearchServer> &srv, const string &name)
+    {
+        istringstream queries_input(queries);
+        ostringstream search_results_output;
+        {
+            LOG_DURATION("Benchmark AddQueriesStream" + name);
+            srv->AddQueriesStream(queries_input, search_results_output);
+            srv->Wait();
+        }
+        // по размеру и хешу вывода результаты разных версий сравниваются между собой
+        const string result = search_results_output.str();
+        cerr << "Benchmark output bytes: " << result.size() << ", hash: " << hash<string>{}(result) << '\n';
+
+        const QueryCacheStats stats = srv->GetQueryCacheStats();
+        cerr << "Benchmark query cache hits: " << stats.hits << ", misses: " << stats.misses
+             << ", hit rate: " << stats.HitRate() << '\n';
+        srv.reset();
+    };
+
+    optional<SearchServer> srv;
+    {
+        LOG_DURATION("Benchmark UpdateDocumentBase");
+        srv.emplace(docs_input);
+    }
+    cerr << "Benchmark postings bytes: " << srv->GetSnapshot()->main->PostingsMemoryUsage() << '\n';
+    {
+        LOG_DURATION("Benchmark SaveIndex");
+        srv->SaveIndex(index_path);
+    }
+    run_queries(srv, "");
+
+    // тот же индекс, открытый из файла
+    {
+        LOG_DURATION("Benchmark LoadIndex");
+        srv.emplace();
+        srv->LoadIndex(index_path);
+    }
+    run_queries(srv, " (loaded)");
+    remove(index_path.c_str());
+}
+
+// Прежний разбор через string_view::find, для сравнения
+vector<string_view> SplitByFind(string_view sv, char sep)
+{
+    vector<string_view> result;
+    while (true)
+    {
+        sv.remove_prefix(min(sv.find_first_not_of(sep), sv.size()));
+        if (sv.empty())
+        {
+            return result;
+        }
+        const size_t space = sv.find(sep);
+        result.push_back(sv.substr(0U, space));
+        sv.remove_prefix(min(space, sv.size()));
+    }
+}
+
+void BenchmarkTokenizer(const vector<string> &paths)
+{
+    constexpr size_t RepeatsCount = 20U;
+
+    for (const string &path : paths)
+    {
+        ifstream input(path);
+        if (not input)
+        {
+            throw runtime_error("Didn't open file " + path);
+        }
+        vector<string> lines;
+        size_t bytes = 0U;
+        for (string line; getline(input, line);)
+        {
+            bytes += line.size();
+            lines.push_back(move(line));
+        }
+        cerr << "Benchmark tokenizer " << path << ": " << lines.size() << " lines, " << bytes << " bytes\n";
+
+        // число слов и их суммарная длина должны совпасть у всех способов
+        auto measure = [&lines](const string &name, auto split_line)
+        {
+            size_t tokens_count = 0U;
+            size_t tokens_bytes = 0U;
+            {
+                LOG_DURATION("Benchmark tokenizer " + name);
+                for (size_t i = 0U; i < RepeatsCount; ++i)
+                {
+                    for (const string &line : lines)
+                    {
+                        split_line(line, [&](string_view token)
+                        {
+                            ++tokens_count;
+                            tokens_bytes += token.size();
+                        });
+                    }
+                }
+            }
+            cerr << "  tokens: " << tokens_count / RepeatsCount << ", bytes: " << tokens_bytes / RepeatsCount << '\n';
+        };
+
+        measure("find + vector", [](string_view line, auto func)
+        {
+            for (string_view token : SplitByFind(line, ' '))
+            {
+                func(token);
+            }
+        });
+        measure("SplitBy", [](string_view line, auto func)
+        {
+            for (string_view token : SplitBy(line, ' '))
+            {
+                func(token);
+            }
+        });
+        measure("ForEachTokenScalar", [](string_view line, auto func) { ForEachTokenScalar(line, ' ', func); });
+        measure("ForEachToken", [](string_view line, auto func) { ForEachToken(line, ' ', func); });
+    }
+}
@@ -0,0 +1,65 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SEARCH_HAS_MMAP
+#endif
+
+MappedFile::MappedFile(const string &path)
+{
+#if defined(SEARCH_HAS_MMAP)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw runtime_error("Can't open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 and st.st_size > 0)
+    {
+        void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            _data = static_cast<const uint8_t *>(data);
+            _size = static_cast<size_t>(st.st_size);
+            _mapped = true;
+        }
+    }
+    close(fd);
+
+    if (_mapped)
+    {
+        return;
+    }
+#endif
+
+    // пустой файл, не обычный файл или нет mmap
+    ifstream input(path, ios::binary | ios::ate);
+    if (not input)
+    {
+        throw runtime_error("Can't open " + path);
+    }
+    _size = static_cast<size_t>(input.tellg());
+    _content.resize((_size + sizeof(uint64_t) - 1U) / sizeof(uint64_t));
+    input.seekg(0);
+    input.read(reinterpret_cast<char *>(_content.data()), static_cast<streamsize>(_size));
+    _data = reinterpret_cast<const uint8_t *>(_content.data());
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(SEARCH_HAS_MMAP)
+    if (_mapped)
+    {
+        munmap(const_cast<uint8_t *>(_data), _size);
+    }
+#endif
+}
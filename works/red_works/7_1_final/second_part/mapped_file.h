@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Файл, отображённый в память только для чтения. Данные доступны, пока жив объект,
+// и выровнены не хуже чем на 8 байт. Там, где mmap недоступен, файл целиком
+// читается в память. Бросает runtime_error, если файл не удалось открыть
+class MappedFile
+{
+public:
+    explicit MappedFile(const string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *Data() const
+    { return _data; }
+
+    size_t Size() const
+    { return _size; }
+
+private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0U;
+    bool _mapped = false;
+    vector<uint64_t> _content; // если отображение не удалось
+};
@@ -19,4 +19,5 @@ string Join(char c, const Container &cont)
 }
 
 string_view Strip(string_view sv);
+// Непустые куски sv между разделителями sep. Без выделения памяти — ForEachToken из tokenizer.h
 vector<string_view> SplitBy(string_view sv, char sep);
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "query_cache.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+QueryCache::QueryCache(size_t capacity)
+    : _shard_capacity((capacity + ShardsCount - 1U) / ShardsCount)
+{
+}
+
+string QueryCache::NormalizeQuery(string_view query)
+{
+    static thread_local vector<string_view> words;
+    words.clear();
+    ForEachToken(query, ' ', [](string_view word) { words.push_back(word); });
+    sort(words.begin(), words.end());
+
+    string result;
+    for (const string_view word : words)
+    {
+        if (not result.empty())
+        {
+            result += ' ';
+        }
+        result += word;
+    }
+    return result;
+}
+
+bool QueryCache::Find(const string &key, string &result)
+{
+    Shard &shard = GetShard(key);
+    lock_guard lock(shard.m);
+
+    const auto it = shard.ids.find(key);
+    if (it == shard.ids.end())
+    {
+        return false;
+    }
+    // найденный ответ становится самым недавним
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    result += it->second->second;
+    return true;
+}
+
+void QueryCache::Insert(string key, string value)
+{
+    if (_shard_capacity == 0U)
+    {
+        return;
+    }
+
+    Shard &shard = GetShard(key);
+    lock_guard lock(shard.m);
+
+    // ответ мог сохранить другой поток, пока этот его считал
+    if (shard.ids.count(key) > 0U)
+    {
+        return;
+    }
+    if (shard.entries.size() == _shard_capacity)
+    {
+        shard.ids.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(move(key), move(value));
+    shard.ids.emplace(shard.entries.front().first, shard.entries.begin());
+}
+
+size_t QueryCache::Size() const
+{
+    size_t result = 0U;
+    for (const Shard &shard : _shards)
+    {
+        lock_guard lock(shard.m);
+        result += shard.entries.size();
+    }
+    return result;
+}
+
+QueryCache::Shard &QueryCache::GetShard(const string &key)
+{
+    return _shards[hash<string>{}(key) % ShardsCount];
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using namespace std;
+
+// Ограниченный кэш ответов на запросы, общий для потоков. Ключ — нормализованный
+// запрос (см. NormalizeQuery), значение — готовая строка результатов.
+// Кэш разбит на независимые части со своими мьютексами, чтобы потоки реже ждали
+// друг друга; в каждой части при переполнении вытесняется давно не использованный ответ
+class QueryCache
+{
+public:
+    explicit QueryCache(size_t capacity);
+
+    // Слова запроса по возрастанию через пробел. Запросы из одних и тех же слов
+    // с теми же повторами дают один ключ, а значит, и один ответ
+    static string NormalizeQuery(string_view query);
+
+    // Дописывает к result сохранённый ответ и возвращает true, если он есть
+    bool Find(const string &key, string &result);
+    void Insert(string key, string value);
+
+    size_t Size() const;
+
+private:
+    static constexpr size_t ShardsCount = 16U;
+
+    struct Shard
+    {
+        list<pair<string, string>> entries;                                  // от недавних к давним
+        unordered_map<string_view, list<pair<string, string>>::iterator> ids; // ключи — строки entries
+        mutable mutex m;
+    };
+
+    size_t _shard_capacity;
+    array<Shard, ShardsCount> _shards;
+
+    Shard &GetShard(const string &key);
+};
@@ -1,151 +1,631 @@
 #include "search_server.h"
 #include "parse.h"
+#include "tokenizer.h"
 #include <algorithm>
-#include <thread>
+#include <chrono>
+#include <deque>
+#include <sstream>
+#include <stdexcept>
 
 SearchServer::SearchServer(istream &document_input)
 {
-    UpdateDocumentBaseSingleThread(document_input);
+    UpdateDocumentBaseSingleThread(document_input, ++_base_requests);
+}
+
+SearchServer::~SearchServer()
+{
+    // вызовы пользуются пулом, поэтому дожидаемся их до разрушения пула
+    Wait();
+}
+
+void SearchServer::Wait()
+{
+    // фоновое слияние может быть запущено, пока ждём другие вызовы
+    while (not _futures.empty())
+    {
+        for (auto &f : _futures)
+        {
+            f.wait();
+        }
+        RemoveFinishedFutures();
+    }
 }
 
 void SearchServer::UpdateDocumentBase(istream &document_input)
 {
+    RemoveFinishedFutures();
+    // номер выдаётся здесь, а не в задаче: задачи захватывают мьютекс в любом порядке
     _futures.push_back(
-        async(&SearchServer::UpdateDocumentBaseSingleThread, this, ref(document_input))
+        async(launch::async, &SearchServer::UpdateDocumentBaseSingleThread, this, ref(document_input),
+              ++_base_requests)
     );
 }
 
 void SearchServer::AddQueriesStream(istream &query_input, ostream &search_results_output)
 {
+    RemoveFinishedFutures();
     _futures.push_back(
-        async(&SearchServer::AddQueriesStreamSingleThread, this, ref(query_input), ref(search_results_output))
+        async(launch::async, &SearchServer::AddQueriesStreamSingleThread, this,
+              ref(query_input), ref(search_results_output))
     );
 }
 
-void SearchServer::UpdateDocumentBaseSingleThread(istream &document_input)
+void SearchServer::RemoveFinishedFutures()
+{
+    auto is_finished = [](const future<void> &f) { return f.wait_for(chrono::seconds(0)) == future_status::ready; };
+    _futures.erase(remove_if(_futures.begin(), _futures.end(), is_finished), _futures.end());
+}
+
+void SearchServer::UpdateDocumentBaseSingleThread(istream &document_input, uint64_t base_request)
 {
-    _m_updating_index.lock();
+    lock_guard lock(_m_updating_index);
 
-    _indexes_using_info.access().ref.updating_index = true;
-    // ждём пока текущий индекс освободится
-    while (_indexes_using_info.access().ref.cur_index_users_count != 0U)
+    // более новая база уже опубликована, строить эту незачем
+    if (base_request < _published_base_request)
     {
-        this_thread::sleep_for(ThreadSleepTime);
+        return;
     }
+    PublishBase(make_shared<const Index>(BuildIndex(document_input)), base_request);
+}
 
-    _cur_index.data.clear();
-    _cur_index.docs_count = 0U;
-    for (string current_document; getline(document_input, current_document);)
+void SearchServer::PublishBase(shared_ptr<const Index> main, uint64_t base_request)
+{
+    if (base_request < _published_base_request)
+    {
+        return;
+    }
+    _published_base_request = base_request;
+
+    auto snapshot = make_shared<IndexSnapshot>();
+    snapshot->main = move(main);
+    snapshot->docs_count = snapshot->main->docs_count;
+    snapshot->base_version = GetSnapshot()->base_version + 1U;
+    Publish(move(snapshot));
+}
+
+size_t SearchServer::AddDocuments(istream &document_input)
+{
+    bool start_merge = false;
+    size_t first_doc_id = 0U;
+    {
+        lock_guard lock(_m_updating_index);
+
+        const shared_ptr<const IndexSnapshot> current = GetSnapshot();
+        first_doc_id = current->docs_count;
+
+        Index delta = BuildIndex(document_input, first_doc_id);
+        if (delta.docs_count == first_doc_id)
+        {
+            return first_doc_id;
+        }
+
+        auto snapshot = make_shared<IndexSnapshot>(*current);
+        snapshot->docs_count = delta.docs_count;
+        snapshot->deltas.push_back(make_shared<const Index>(move(delta)));
+        start_merge = snapshot->deltas.size() > MaxDeltaIndexes and not _merging;
+        _merging = _merging or start_merge;
+        Publish(move(snapshot));
+    }
+
+    if (start_merge)
     {
-        const size_t doc_id = _cur_index.docs_count++;
-        _cur_index.Add(current_document, doc_id);
+        RemoveFinishedFutures();
+        _futures.push_back(async(launch::async, &SearchServer::MergeDeltas, this));
     }
+    return first_doc_id;
+}
 
-    _indexes_using_info.access().ref.updating_index = false;
-    // ждём пока старый индекс освободится
-    while (_indexes_using_info.access().ref.old_index_users_count != 0U)
+size_t SearchServer::AddDocument(string_view document)
+{
+    istringstream document_input(string{document});
+    return AddDocuments(document_input);
+}
+
+bool SearchServer::RemoveDocument(size_t doc_id)
+{
+    lock_guard lock(_m_updating_index);
+
+    const shared_ptr<const IndexSnapshot> current = GetSnapshot();
+    if (doc_id >= current->docs_count or current->IsRemoved(doc_id))
     {
-        this_thread::sleep_for(ThreadSleepTime);
+        return false;
     }
 
-    _old_index = _cur_index;
+    // отметки копируются целиком: бит на документ, это дёшево по сравнению с индексом
+    auto removed = current->removed != nullptr ? make_shared<vector<bool>>(*current->removed)
+                                               : make_shared<vector<bool>>();
+    removed->resize(current->docs_count);
+    (*removed)[doc_id] = true;
 
-    _m_updating_index.unlock();
+    auto snapshot = make_shared<IndexSnapshot>(*current);
+    snapshot->removed = move(removed);
+    Publish(move(snapshot));
+    return true;
 }
 
-void SearchServer::AddQueriesStreamSingleThread(istream &query_input, ostream &search_results_output)
+// Сливает дельта-индексы снимка, взятого в начале, без блокировки, а затем
+// подменяет в текущем снимке слитые индексы результатом. Дельта-индексы,
+// добавленные за время слияния, остаются после результата, и если их снова
+// слишком много, слияние повторяется. Если база за это время заменена целиком,
+// результат выбрасывается
+void SearchServer::MergeDeltas()
 {
-    for (string current_query; getline(query_input, current_query);)
+    while (true)
     {
-        vector<string_view> words = SplitBy(current_query, ' ');
+        const shared_ptr<const IndexSnapshot> source = GetSnapshot();
+        const size_t deltas_docs_count = source->docs_count - source->main->docs_count;
+        const bool merge_main = deltas_docs_count * MainToDeltaRatio >= source->main->docs_count;
+
+        static const vector<bool> no_removed;
+        const vector<bool> &removed = source->removed != nullptr ? *source->removed : no_removed;
 
-        bool use_old_index = false;
-        if (auto info = _indexes_using_info.access(); info.ref.updating_index)
+        Index merged;
+        if (merge_main)
         {
-            use_old_index = true;
-            ++info.ref.old_index_users_count;
+            merged.Append(*source->main, removed);
         }
-        else
+        for (const auto &delta : source->deltas)
         {
-            use_old_index = false;
-            ++info.ref.cur_index_users_count;
+            merged.Append(*delta, removed);
         }
-        auto &index = use_old_index ? _old_index : _cur_index;
+        merged.docs_count = source->docs_count;
 
-        vector<size_t> doc_id_hits(index.docs_count);
-        for (const string_view word : words)
+        lock_guard lock(_m_updating_index);
+
+        const shared_ptr<const IndexSnapshot> current = GetSnapshot();
+        if (current->base_version == source->base_version)
         {
-            for (const size_t doc_id : index.Lookup(string(word)))
+            // слияние одно, поэтому слитые дельта-индексы — начало текущего списка
+            auto snapshot = make_shared<IndexSnapshot>(*current);
+            const auto added_deltas_begin = current->deltas.begin() + source->deltas.size();
+            if (merge_main)
+            {
+                snapshot->main = make_shared<const Index>(move(merged));
+                snapshot->deltas.assign(added_deltas_begin, current->deltas.end());
+            }
+            else
             {
-                ++doc_id_hits[doc_id];
+                snapshot->deltas.assign(1U, make_shared<const Index>(move(merged)));
+                snapshot->deltas.insert(snapshot->deltas.end(), added_deltas_begin, current->deltas.end());
             }
+            Publish(move(snapshot));
         }
 
-        if (use_old_index)
+        if (GetSnapshot()->deltas.size() <= MaxDeltaIndexes)
+        {
+            _merging = false;
+            return;
+        }
+    }
+}
+
+void SearchServer::LoadIndex(const string &path)
+{
+    const uint64_t base_request = ++_base_requests;
+
+    // файл открывается до блокировки: если он повреждён, база не меняется
+    auto main = make_shared<const Index>(Index::Load(path));
+
+    lock_guard lock(_m_updating_index);
+    PublishBase(move(main), base_request);
+}
+
+void SearchServer::SaveIndex(const string &path) const
+{
+    const shared_ptr<const IndexSnapshot> snapshot = GetSnapshot();
+    if (snapshot->deltas.empty() and snapshot->removed == nullptr)
+    {
+        snapshot->main->Save(path);
+        return;
+    }
+
+    // как при слиянии с основным индексом
+    static const vector<bool> no_removed;
+    const vector<bool> &removed = snapshot->removed != nullptr ? *snapshot->removed : no_removed;
+
+    Index merged;
+    merged.Append(*snapshot->main, removed);
+    for (const auto &delta : snapshot->deltas)
+    {
+        merged.Append(*delta, removed);
+    }
+    merged.docs_count = snapshot->docs_count;
+    merged.Save(path);
+}
+
+void SearchServer::Publish(shared_ptr<IndexSnapshot> snapshot)
+{
+    // ответы прошлых снимков остаются в их кэшах и уходят вместе с ними
+    if (QueryCacheCapacity > 0U)
+    {
+        snapshot->query_cache = make_shared<QueryCache>(QueryCacheCapacity);
+    }
+    // запросы, начатые раньше, дорабатывают со своим снимком,
+    // старые индексы освободятся вместе с последним из них
+    atomic_store(&_snapshot, shared_ptr<const IndexSnapshot>(move(snapshot)));
+}
+
+namespace
+{
+
+// Индекс куска базы, документы которого получают номера first_doc_id, first_doc_id + 1, ...
+Index BuildShard(vector<string> documents, size_t first_doc_id)
+{
+    Index shard;
+    for (size_t i = 0U; i < documents.size(); ++i)
+    {
+        shard.Add(documents[i], first_doc_id + i);
+    }
+    shard.docs_count = first_doc_id + documents.size();
+    return shard;
+}
+
+} // namespace
+
+// Документы читаются кусками по ShardDocsCount, каждый кусок индексируется
+// отдельной задачей пула, а готовые куски дописываются в общий индекс по порядку.
+// Пока задачи работают, читаются следующие документы. Задач одновременно не больше,
+// чем по две на поток пула, поэтому в памяти лишь несколько непроиндексированных кусков
+Index SearchServer::BuildIndex(istream &document_input, size_t first_doc_id)
+{
+    const size_t max_shards_in_flight = 2U * _pool.Size();
+
+    Index index;
+    deque<future<Index>> shards;
+    auto append_oldest_shard = [&index, &shards]()
+    {
+        index.Append(shards.front().get());
+        shards.pop_front();
+    };
+
+    vector<string> documents;
+    size_t docs_count = first_doc_id;
+    auto start_shard = [&]()
+    {
+        if (documents.empty())
         {
-            --_indexes_using_info.access().ref.old_index_users_count;
+            return;
         }
-        else
+        if (shards.size() == max_shards_in_flight)
         {
-            --_indexes_using_info.access().ref.cur_index_users_count;
+            append_oldest_shard();
         }
+        const size_t first_doc_id = docs_count - documents.size();
+        shards.push_back(_pool.Submit([documents = move(documents), first_doc_id]() mutable
+        {
+            return BuildShard(move(documents), first_doc_id);
+        }));
+        documents = {};
+        documents.reserve(ShardDocsCount);
+    };
 
-        vector<pair<size_t, size_t>> search_results;
-        search_results.reserve(MaxRelevantSearchResults);
+    documents.reserve(ShardDocsCount);
+    for (string current_document; getline(document_input, current_document);)
+    {
+        documents.push_back(move(current_document));
+        ++docs_count;
+        if (documents.size() == ShardDocsCount)
+        {
+            start_shard();
+        }
+    }
+    start_shard();
 
-        // находим топ документов по релевантности
-        while (search_results.size() != MaxRelevantSearchResults)
+    while (not shards.empty())
+    {
+        append_oldest_shard();
+    }
+    index.docs_count = docs_count;
+    return index;
+}
+
+shared_ptr<const IndexSnapshot> SearchServer::GetSnapshot() const
+{
+    return atomic_load(&_snapshot);
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const
+{
+    return {_query_cache_hits.load(), _query_cache_misses.load()};
+}
+
+// Запросы читаются пачками по QueriesBatchSize, пачки обрабатываются задачами пула,
+// и их результаты выводятся в порядке запросов. Как и при построении индекса,
+// задач одновременно не больше, чем по две на поток пула
+void SearchServer::AddQueriesStreamSingleThread(istream &query_input, ostream &search_results_output)
+{
+    const size_t max_batches_in_flight = 2U * _pool.Size();
+
+    deque<future<string>> batches;
+    auto write_oldest_batch = [&search_results_output, &batches]()
+    {
+        search_results_output << batches.front().get();
+        batches.pop_front();
+    };
+
+    vector<string> queries;
+    auto start_batch = [&]()
+    {
+        if (queries.empty())
+        {
+            return;
+        }
+        if (batches.size() == max_batches_in_flight)
         {
-            auto it_max_hits = max_element(doc_id_hits.begin(), doc_id_hits.end());
-            if (*it_max_hits == 0U)
+            write_oldest_batch();
+        }
+        // снимок на время пачки: все её запросы видят один и тот же индекс
+        batches.push_back(_pool.Submit([this, snapshot = GetSnapshot(), queries = move(queries)]()
+        {
+            return ProcessQueries(*snapshot, queries);
+        }));
+        queries = {};
+        queries.reserve(QueriesBatchSize);
+    };
+
+    queries.reserve(QueriesBatchSize);
+    for (string current_query; getline(query_input, current_query);)
+    {
+        queries.push_back(move(current_query));
+        if (queries.size() == QueriesBatchSize)
+        {
+            start_batch();
+        }
+    }
+    start_batch();
+
+    while (not batches.empty())
+    {
+        write_oldest_batch();
+    }
+}
+
+string SearchServer::ProcessQueries(const IndexSnapshot &snapshot, const vector<string> &queries)
+{
+    // счётчики и результаты переиспользуются всеми запросами потока;
+    // каждое обращение к thread_local проверяет инициализацию, поэтому в цикле — ссылка
+    static thread_local HitCounter thread_hit_counter;
+    HitCounter &hit_counter = thread_hit_counter;
+    vector<HitCounter::SearchResult> search_results;
+    search_results.reserve(MaxRelevantSearchResults);
+
+    QueryCache *const query_cache = snapshot.query_cache.get();
+    size_t cache_hits = 0U;
+    size_t cache_misses = 0U;
+
+    string output;
+    string serp; // результаты одного запроса после двоеточия
+    for (const string &current_query : queries)
+    {
+        output += current_query;
+        output += ':';
+
+        serp.clear();
+        string key;
+        if (query_cache != nullptr)
+        {
+            key = QueryCache::NormalizeQuery(current_query);
+            if (query_cache->Find(key, serp))
             {
-                break;
+                ++cache_hits;
+                output += serp;
+                output += '\n';
+                continue;
             }
-            const size_t doc_id = it_max_hits - doc_id_hits.begin();
-            size_t &hits_count = *it_max_hits;
-            search_results.emplace_back(doc_id, hits_count);
-            hits_count = 0U;
-        }
-
-        sort(begin(search_results),
-             end(search_results),
-             [](pair<size_t, size_t> lhs, pair<size_t, size_t> rhs)
-             {
-                 if (rhs.second < lhs.second)
-                 {
-                     return true;
-                 }
-                 else if (rhs.second == lhs.second)
-                 {
-                     return rhs.first > lhs.first;
-                 }
-                 return false;
-             }
-        );
-
-        search_results_output << current_query << ':';
+            ++cache_misses;
+        }
+
+        hit_counter.Reset(snapshot.docs_count);
+        ForEachToken(current_query, ' ', [&](string_view word)
+        {
+            snapshot.ForEachDoc(word, [&](size_t doc_id, size_t hits) { hit_counter.Add(doc_id, hits); });
+        });
+
+        // находим топ документов по релевантности
+        hit_counter.PopTop(MaxRelevantSearchResults, search_results);
+
         for (auto [doc_id, hit_count] : search_results)
         {
-            search_results_output << " {docid: " << doc_id << ", hitcount: " << hit_count << '}';
+            serp += " {docid: ";
+            serp += to_string(doc_id);
+            serp += ", hitcount: ";
+            serp += to_string(hit_count);
+            serp += '}';
+        }
+        output += serp;
+        output += '\n';
+
+        if (query_cache != nullptr)
+        {
+            query_cache->Insert(move(key), serp);
         }
-        search_results_output << '\n';
     }
+
+    _query_cache_hits += cache_hits;
+    _query_cache_misses += cache_misses;
+    return output;
 }
 
 void Index::Add(string_view document, size_t doc_id)
 {
-    for (auto &word : SplitBy(document, ' '))
+    // номера слов документа сортируются, чтобы повторы одного слова шли подряд
+    static thread_local vector<TermId> terms;
+    terms.clear();
+    ForEachToken(document, ' ', [this](string_view word) { terms.push_back(AddTerm(word)); });
+    sort(terms.begin(), terms.end());
+
+    for (auto it = terms.begin(); it != terms.end();)
+    {
+        const auto it_next = find_if(it, terms.end(), [term = *it](TermId other) { return other != term; });
+
+        Postings &postings = _postings[*it];
+        if (not postings.data.empty() and doc_id <= postings.last_doc_id)
+        {
+            throw invalid_argument("Documents must be added in increasing doc_id order");
+        }
+        WriteVarint(doc_id - postings.last_doc_id, postings.data);
+        WriteVarint(static_cast<uint64_t>(it_next - it), postings.data);
+        postings.last_doc_id = doc_id;
+
+        it = it_next;
+    }
+}
+
+void Index::Append(Index &&other)
+{
+    // списки открытого из файла индекса лежат в файле, их переносит копирование
+    if (other._file != nullptr)
+    {
+        Append(other, {});
+        return;
+    }
+
+    if (_terms.empty() and _file == nullptr)
+    {
+        const size_t min_docs_count = docs_count;
+        *this = move(other);
+        docs_count = max(docs_count, min_docs_count);
+        return;
+    }
+
+    for (TermId other_term = 0U; other_term < other._terms.size(); ++other_term)
+    {
+        const vector<uint8_t> &from = other._postings[other_term].data;
+        Postings &to = _postings[AddTerm(other._terms[other_term])];
+        if (from.empty())
+        {
+            continue;
+        }
+
+        // первая разность в other отсчитана от нуля — это номер документа,
+        // её нужно пересчитать от последнего документа этого индекса,
+        // остальные пары переносятся как есть
+        const uint8_t *it = from.data();
+        const size_t first_doc_id = ReadVarint(it);
+        if (not to.data.empty() and first_doc_id <= to.last_doc_id)
+        {
+            throw invalid_argument("Appended documents must go after existing ones");
+        }
+        WriteVarint(first_doc_id - to.last_doc_id, to.data);
+        to.data.insert(to.data.end(), it, from.data() + from.size());
+        to.last_doc_id = other._postings[other_term].last_doc_id;
+    }
+
+    docs_count = max(docs_count, other.docs_count);
+}
+
+void Index::Append(const Index &other, const vector<bool> &removed)
+{
+    for (TermId other_term = 0U; other_term < other.TermsCount(); ++other_term)
+    {
+        // слово добавляется, даже если все его документы удалены:
+        // номера слов не зависят от удалений
+        Postings &to = _postings[AddTerm(other.Term(other_term))];
+        other.ForEachTermDoc(other_term, [&to, &removed](size_t doc_id, size_t hits)
+        {
+            if (doc_id < removed.size() and removed[doc_id])
+            {
+                return;
+            }
+            if (not to.data.empty() and doc_id <= to.last_doc_id)
+            {
+                throw invalid_argument("Appended documents must go after existing ones");
+            }
+            WriteVarint(doc_id - to.last_doc_id, to.data);
+            WriteVarint(hits, to.data);
+            to.last_doc_id = doc_id;
+        });
+    }
+
+    docs_count = max(docs_count, other.docs_count);
+}
+
+Index::TermId Index::AddTerm(string_view word)
+{
+    if (_file != nullptr)
     {
-        data[string(word)].push_back(doc_id);
+        throw logic_error("Index loaded from file is read-only");
     }
+
+    if (auto it = _term_ids.find(word); it != _term_ids.end())
+    {
+        return it->second;
+    }
+
+    const TermId term = static_cast<TermId>(_terms.size());
+    _term_ids.emplace(_terms.emplace_back(word), term);
+    _postings.emplace_back();
+    return term;
 }
 
-const Index::DocIdHits &Index::Lookup(const string &word) const
+Index::TermId Index::FindTerm(string_view word) const
 {
-    if (auto it = data.find(word); it != data.end())
+    if (_file != nullptr)
+    {
+        return FindMappedTerm(word);
+    }
+
+    if (auto it = _term_ids.find(word); it != _term_ids.end())
     {
         return it->second;
     }
-    static DocIdHits empty;
-    return empty;
+    return NoTerm;
+}
+
+string_view Index::Term(TermId term) const
+{
+    if (_file != nullptr)
+    {
+        return {_mapped.chars + _mapped.term_begins[term],
+                _mapped.term_begins[term + 1U] - _mapped.term_begins[term]};
+    }
+    return _terms[term];
+}
+
+size_t Index::PostingsMemoryUsage() const
+{
+    if (_file != nullptr)
+    {
+        // списки не копируются в память, а читаются из файла
+        return _mapped.postings_begins[_mapped.terms_count] + (_mapped.terms_count + 1U) * sizeof(uint64_t);
+    }
+
+    size_t result = _postings.capacity() * sizeof(Postings);
+    for (const Postings &postings : _postings)
+    {
+        result += postings.data.capacity();
+    }
+    return result;
+}
+
+void HitCounter::Reset(size_t docs_count)
+{
+    // после PopTop все счётчики нулевые, поэтому массив только растёт
+    if (_hits.size() < docs_count)
+    {
+        _hits.resize(docs_count);
+    }
+}
+
+void HitCounter::PopTop(size_t max_count, vector<SearchResult> &result)
+{
+    auto is_more_relevant = [this](size_t lhs, size_t rhs)
+    {
+        return _hits[lhs] > _hits[rhs] or (_hits[lhs] == _hits[rhs] and lhs < rhs);
+    };
+
+    const size_t count = min(max_count, _touched.size());
+    partial_sort(_touched.begin(), _touched.begin() + count, _touched.end(), is_more_relevant);
+
+    result.clear();
+    for (size_t i = 0U; i < count; ++i)
+    {
+        result.emplace_back(_touched[i], _hits[_touched[i]]);
+    }
+
+    for (const size_t doc_id : _touched)
+    {
+        _hits[doc_id] = 0U;
+    }
+    _touched.clear();
 }
@@ -1,60 +1,345 @@
 #pragma once
-#include "synchronized.h"
+#include "mapped_file.h"
+#include "query_cache.h"
+#include "thread_pool.h"
+#include "varint.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <istream>
+#include <limits>
 #include <ostream>
 #include <vector>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <chrono>
+#include <string_view>
+#include <unordered_map>
 #include <future>
 
 using namespace std;
 
+// Обратный индекс. Каждое слово хранится один раз и получает плотный номер,
+// списки документов лежат в массиве по этим номерам. Поиск слова идёт по
+// string_view без создания строки.
+//
+// Список документов слова — пары (doc_id, число вхождений) по возрастанию doc_id.
+// Пара записана как разность с прошлым doc_id и число вхождений, оба в varint,
+// поэтому обычная пара занимает два байта.
+//
+// Индекс сохраняется в файл (Save) и открывается из него (Load) без разбора:
+// словарь, хеш-таблица слов и списки документов читаются прямо из отображённого
+// в память файла. В такой индекс нельзя добавлять документы, но его можно
+// дописать в другой индекс
 class Index
 {
 public:
-    using DocIdHits = vector<size_t>;
+    using TermId = uint32_t;
+
+    static constexpr TermId NoTerm = numeric_limits<TermId>::max();
+
+    Index() = default;
+    // ключи словаря ссылаются на строки самого индекса, копия ссылалась бы на чужие;
+    // при перемещении строки остаются на месте
+    Index(const Index &) = delete;
+    Index &operator=(const Index &) = delete;
+    Index(Index &&) = default;
+    Index &operator=(Index &&) = default;
 
+    // Документы добавляются по возрастанию doc_id.
+    // Бросает invalid_argument, если doc_id не больше уже добавленного
     void Add(string_view document, size_t doc_id);
-    const DocIdHits &Lookup(const string &word) const;
 
-    map<string, DocIdHits> data;
+    // Дописывает индекс документов, идущих после уже добавленных. Номера слов
+    // получаются такими же, как если бы документы добавлялись в этот индекс по одному.
+    // Бросает invalid_argument, если документы other не идут после документов индекса
+    void Append(Index &&other);
+    // То же, но копирует other и пропускает документы, отмеченные в removed
+    void Append(const Index &other, const vector<bool> &removed);
+
+    // Вызывает func(doc_id, hits) для каждого документа, где встречается слово,
+    // по возрастанию doc_id. Список раскодируется прямо во время обхода
+    template <typename Func>
+    void ForEachDoc(string_view word, Func func) const;
+
+    // Номер слова или NoTerm, если в документах его нет
+    TermId FindTerm(string_view word) const;
+
+    size_t TermsCount() const
+    { return _file != nullptr ? _mapped.terms_count : _terms.size(); }
+
+    string_view Term(TermId term) const;
+
+    // Память под списки документов, байт
+    size_t PostingsMemoryUsage() const;
+
+    // Записывает индекс в файл. Бросает runtime_error, если записать не удалось
+    void Save(const string &path) const;
+    // Открывает индекс, сохранённый Save. Файл остаётся отображённым, пока жив индекс
+    // или его части. Бросает runtime_error, если файла нет или он повреждён
+    static Index Load(const string &path);
+
     size_t docs_count = 0U;
+
+private:
+    struct Postings
+    {
+        vector<uint8_t> data;
+        size_t last_doc_id = 0U;
+    };
+
+    deque<string> _terms;                         // номер → слово, строки не перемещаются
+    unordered_map<string_view, TermId> _term_ids; // ключи указывают на строки _terms
+    vector<Postings> _postings;                   // номер → закодированные пары
+
+    // разделы открытого файла, см. index_file.cpp
+    struct MappedSections
+    {
+        size_t terms_count = 0U;
+        const uint64_t *term_begins = nullptr;     // terms_count + 1 смещений в chars
+        const uint64_t *postings_begins = nullptr; // terms_count + 1 смещений в postings
+        const uint32_t *slots = nullptr;           // номер слова + 1, 0 — пусто
+        size_t slots_count = 0U;                   // степень двойки
+        const char *chars = nullptr;
+        const uint8_t *postings = nullptr;
+    };
+
+    shared_ptr<const MappedFile> _file; // nullptr, если индекс строится в памяти
+    MappedSections _mapped;
+
+    // бросает logic_error для открытого из файла индекса
+    TermId AddTerm(string_view word);
+    TermId FindMappedTerm(string_view word) const;
+
+    pair<const uint8_t *, const uint8_t *> TermPostings(TermId term) const
+    {
+        if (_file != nullptr)
+        {
+            return {_mapped.postings + _mapped.postings_begins[term],
+                    _mapped.postings + _mapped.postings_begins[term + 1U]};
+        }
+        const vector<uint8_t> &data = _postings[term].data;
+        return {data.data(), data.data() + data.size()};
+    }
+
+    template <typename Func>
+    void ForEachTermDoc(TermId term, Func func) const;
+};
+
+template <typename Func>
+void Index::ForEachDoc(string_view word, Func func) const
+{
+    if (const TermId term = FindTerm(word); term != NoTerm)
+    {
+        ForEachTermDoc(term, func);
+    }
+}
+
+template <typename Func>
+void Index::ForEachTermDoc(TermId term, Func func) const
+{
+    auto [it, end] = TermPostings(term);
+    size_t doc_id = 0U;
+    while (it != end)
+    {
+        // за разностью doc_id всегда записано число вхождений
+        doc_id += ReadVarintNotLast(it);
+        func(doc_id, static_cast<size_t>(ReadVarint(it)));
+    }
+}
+
+// Согласованное состояние базы для запросов: основной индекс, небольшие дельта-индексы
+// документов, добавленных после него, и отметки удалённых документов. Номера документов
+// дельта-индексов идут после номеров основного и друг друга
+struct IndexSnapshot
+{
+    shared_ptr<const Index> main = make_shared<const Index>();
+    vector<shared_ptr<const Index>> deltas;
+    shared_ptr<const vector<bool>> removed; // по doc_id; nullptr, если удалённых нет
+    size_t docs_count = 0U;                 // вместе с удалёнными
+    uint64_t base_version = 0U;             // растёт при каждой замене базы целиком
+
+    // Ответы на запросы к этому снимку. Каждый опубликованный снимок получает
+    // новый пустой кэш, поэтому ответы старой базы не видны запросам к новой;
+    // nullptr — без кэша
+    shared_ptr<QueryCache> query_cache;
+
+    bool IsRemoved(size_t doc_id) const
+    { return removed != nullptr and doc_id < removed->size() and (*removed)[doc_id]; }
+
+    // Как Index::ForEachDoc по всем индексам снимка, без удалённых документов
+    template <typename Func>
+    void ForEachDoc(string_view word, Func func) const;
+};
+
+template <typename Func>
+void IndexSnapshot::ForEachDoc(string_view word, Func func) const
+{
+    auto for_each_index = [this, word](auto index_func)
+    {
+        main->ForEachDoc(word, index_func);
+        for (const auto &delta : deltas)
+        {
+            delta->ForEachDoc(word, index_func);
+        }
+    };
+
+    // без удалённых документов проверка на каждом вхождении не нужна
+    if (removed == nullptr)
+    {
+        for_each_index(func);
+    }
+    else
+    {
+        for_each_index([this, &func](size_t doc_id, size_t hits)
+        {
+            if (not IsRemoved(doc_id))
+            {
+                func(doc_id, hits);
+            }
+        });
+    }
+}
+
+// Счётчики попаданий запроса по документам. Массив счётчиков переиспользуется
+// между запросами, а после запроса обнуляются только затронутые документы,
+// поэтому запрос стоит пропорционально числу найденных вхождений слов,
+// а не числу документов в базе
+class HitCounter
+{
+public:
+    using SearchResult = pair<size_t, size_t>; // doc_id, hit_count
+
+    // Готовит счётчики к запросу по базе из docs_count документов
+    void Reset(size_t docs_count);
+
+    void Add(size_t doc_id, size_t hits = 1U)
+    {
+        if (_hits[doc_id] == 0U)
+        {
+            _touched.push_back(doc_id);
+        }
+        _hits[doc_id] += hits;
+    }
+
+    // Переносит в result не более max_count документов по убыванию числа
+    // попаданий, при равенстве — по возрастанию doc_id, и обнуляет счётчики
+    void PopTop(size_t max_count, vector<SearchResult> &result);
+
+private:
+    vector<size_t> _hits;
+    vector<size_t> _touched;
+};
+
+struct QueryCacheStats
+{
+    size_t hits = 0U;
+    size_t misses = 0U;
+
+    double HitRate() const
+    { return hits + misses > 0U ? static_cast<double>(hits) / (hits + misses) : 0.0; }
 };
 
+// Запросы и обновления базы выполняются асинхронно, деструктор их дожидается.
+// Тяжёлая работа — индексирование кусков базы и пачки запросов — идёт в общем
+// пуле потоков, а чтение входа и вывод результатов по порядку — в потоке вызова.
+//
+// Кроме замены базы целиком, документы можно добавлять и удалять по одному.
+// Добавленные документы попадают в новый маленький дельта-индекс, удалённые
+// отмечаются в снимке. Когда дельта-индексов больше MaxDeltaIndexes, они в фоне
+// сливаются в один, а если их документов набралось не меньше 1/MainToDeltaRatio
+// основного индекса — вместе с основным; при слиянии удалённые документы выбрасываются
 class SearchServer
 {
 public:
     SearchServer() = default;
     explicit SearchServer(istream &document_input);
+    ~SearchServer();
+
+    // Заменяет базу в фоне. Замены базы целиком (и LoadIndex) нумеруются в порядке
+    // вызовов, и после Wait опубликована база последнего из них: замена, которая
+    // дошла до публикации позже более новой, отбрасывается
     void UpdateDocumentBase(istream &document_input);
     void AddQueriesStream(istream &query_input, ostream &search_results_output);
 
-private:
-    Index _cur_index;
-    Index _old_index;
+    // Добавляет документы (по одному на строку) после уже имеющихся и возвращает
+    // номер первого из них. Документы видны запросам, начатым после возврата
+    size_t AddDocuments(istream &document_input);
+    size_t AddDocument(string_view document);
 
-    struct IndexesUsingInfo
-    {
-        bool updating_index = false;
-        size_t cur_index_users_count = 0U;
-        size_t old_index_users_count = 0U;
-    };
+    // Убирает документ из результатов поиска, его номер не переиспользуется.
+    // Возвращает false, если такого документа нет или он уже удалён
+    bool RemoveDocument(size_t doc_id);
 
-    Synchronized<IndexesUsingInfo> _indexes_using_info{};
+    // Заменяет базу индексом из файла, сохранённого SaveIndex или Index::Save.
+    // Бросает runtime_error, если файл не открывается, база при этом не меняется
+    void LoadIndex(const string &path);
+    // Сохраняет текущую базу одним индексом, без удалённых документов
+    void SaveIndex(const string &path) const;
 
-    mutex _m_updating_index;
+    // Дожидается всех начатых обновлений базы, фоновых слияний и потоков запросов
+    void Wait();
 
-    vector<future<void>> _futures;
+    // Снимок опубликованного состояния, он не меняется и живёт, пока есть указатель
+    shared_ptr<const IndexSnapshot> GetSnapshot() const;
 
-    void UpdateDocumentBaseSingleThread(istream &document_input);
-    void AddQueriesStreamSingleThread(istream &query_input, ostream &search_results_output);
+    // Попадания в кэш ответов и промахи за всё время работы сервера
+    QueryCacheStats GetQueryCacheStats() const;
 
     static constexpr size_t MaxDocsCount = 50'000U + 1U;
     static constexpr size_t MaxQueriesCount = 500'000U + 1U;
     static constexpr size_t MaxRelevantSearchResults = 5U;
 
-    static constexpr chrono::milliseconds ThreadSleepTime{1U};
+    // столько документов подряд индексирует одна задача при обновлении базы
+    static constexpr size_t ShardDocsCount = 1'000U;
+    // столько запросов подряд обрабатывает одна задача
+    static constexpr size_t QueriesBatchSize = 256U;
+
+    static constexpr size_t MaxDeltaIndexes = 8U;
+    static constexpr size_t MainToDeltaRatio = 8U;
+
+    // столько последних различных запросов помнит кэш ответов, 0 — без кэша
+    static constexpr size_t QueryCacheCapacity = 10'000U;
+
+private:
+    // Опубликованное состояние. После публикации не меняется: обновление строит новый
+    // снимок и атомарно подменяет указатель, а запрос работает со снимком,
+    // который держит старые индексы живыми, пока запрос не закончится.
+    // Доступ только через GetSnapshot и Publish
+    shared_ptr<const IndexSnapshot> _snapshot = make_shared<const IndexSnapshot>();
+
+    // изменения базы публикуются по очереди, чтобы ни одно не потерялось
+    mutex _m_updating_index;
+    bool _merging = false; // идёт фоновое слияние, под _m_updating_index
+
+    // номер последней начатой замены базы целиком, выдаётся в вызывающем потоке
+    atomic<uint64_t> _base_requests{0U};
+    // номер последней опубликованной замены, под _m_updating_index
+    uint64_t _published_base_request = 0U;
+
+    ThreadPool _pool;
+
+    // незавершённые вызовы UpdateDocumentBase и AddQueriesStream;
+    // завершённые удаляются при каждом новом вызове
+    vector<future<void>> _futures;
+
+    atomic<size_t> _query_cache_hits{0U};
+    atomic<size_t> _query_cache_misses{0U};
+
+    void UpdateDocumentBaseSingleThread(istream &document_input, uint64_t base_request);
+    Index BuildIndex(istream &document_input, size_t first_doc_id = 0U);
+    void AddQueriesStreamSingleThread(istream &query_input, ostream &search_results_output);
+    string ProcessQueries(const IndexSnapshot &snapshot, const vector<string> &queries);
+
+    // вызывать под _m_updating_index; снимку выдаётся новый кэш ответов
+    void Publish(shared_ptr<IndexSnapshot> snapshot);
+    // публикует снимок с новой базой, если более новая замена ещё не опубликована;
+    // вызывать под _m_updating_index
+    void PublishBase(shared_ptr<const Index> main, uint64_t base_request);
+    void MergeDeltas();
+
+    void RemoveFinishedFutures();
 
     // для профилирования
     // chrono::steady_clock::time_point _startTime;
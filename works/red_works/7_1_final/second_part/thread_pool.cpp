@@ -0,0 +1,44 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t threads_count)
+{
+    threads_count = max<size_t>(threads_count, 1U);
+    _workers.reserve(threads_count);
+    for (size_t i = 0U; i < threads_count; ++i)
+    {
+        _workers.emplace_back(&ThreadPool::Work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard lock(_m);
+        _stopping = true;
+    }
+    _cv.notify_all();
+    for (thread &worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Work()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock lock(_m);
+            _cv.wait(lock, [this]() { return _stopping or not _tasks.empty(); });
+            // при остановке очередь сначала дорабатывается до конца
+            if (_tasks.empty())
+            {
+                return;
+            }
+            task = move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
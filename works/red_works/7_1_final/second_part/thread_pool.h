@@ -0,0 +1,56 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// Фиксированное число потоков с общей очередью задач.
+// Деструктор дожидается выполнения всех поставленных задач.
+// Задача не должна ждать результата другой задачи того же пула:
+// если все потоки заняты ожидающими, ждать будет некому
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads_count = thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Ставит func в очередь. Результат или исключение func передаются через future
+    template <typename Func>
+    future<invoke_result_t<Func>> Submit(Func func);
+
+    size_t Size() const
+    { return _workers.size(); }
+
+private:
+    vector<thread> _workers;
+    deque<function<void()>> _tasks;
+    mutex _m;
+    condition_variable _cv;
+    bool _stopping = false;
+
+    void Work();
+};
+
+template <typename Func>
+future<invoke_result_t<Func>> ThreadPool::Submit(Func func)
+{
+    // packaged_task не копируется, а function требует копируемого объекта
+    auto task = make_shared<packaged_task<invoke_result_t<Func>()>>(move(func));
+    auto result = task->get_future();
+    {
+        lock_guard lock(_m);
+        _tasks.emplace_back([task]() { (*task)(); });
+    }
+    _cv.notify_one();
+    return result;
+}
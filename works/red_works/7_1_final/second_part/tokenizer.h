@@ -0,0 +1,164 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SEARCH_TOKENIZER_SIMD
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SEARCH_TOKENIZER_SIMD
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// Вызывает func(token) для каждого непустого куска text между разделителями sep,
+// слева направо. Память не выделяется, куски — string_view на text.
+//
+// Текст просматривается блоками: сравнение блока с разделителем даёт маску байт-разделителей,
+// а начала и концы слов — это переходы в этой маске, их перебирают по младшему биту.
+// Блок — 32 байта с AVX2, 16 с SSE2; без них и на хвосте короче блока — побайтовый проход.
+// Набор инструкций выбирается при сборке: AVX2 включается флагом компилятора (-mavx2)
+template <typename Func>
+void ForEachToken(string_view text, char sep, Func func);
+
+// Побайтовый вариант ForEachToken, с ним сверяется и сравнивается по скорости блочный
+template <typename Func>
+void ForEachTokenScalar(string_view text, char sep, Func func);
+
+namespace Tokenizer
+{
+
+#if defined(__AVX2__)
+constexpr size_t BlockSize = 32U;
+
+inline uint64_t SeparatorMask(const char *block, char sep)
+{
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    const __m256i eq = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(sep));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+constexpr size_t BlockSize = 16U;
+
+inline uint64_t SeparatorMask(const char *block, char sep)
+{
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    const __m128i eq = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(sep));
+    return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+}
+#endif
+
+// номер младшего единичного бита, mask != 0
+inline unsigned LowestBit(uint64_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+} // namespace Tokenizer
+
+template <typename Func>
+void ForEachToken(string_view text, char sep, Func func)
+{
+    const char *const data = text.data();
+    size_t pos = 0U;
+
+    // начало текущего слова, если in_token
+    size_t token_begin = 0U;
+    bool in_token = false;
+
+#if defined(SEARCH_TOKENIZER_SIMD)
+    using Tokenizer::BlockSize;
+    constexpr uint64_t BlockBits = (uint64_t{1U} << BlockSize) - 1U;
+
+    for (; pos + BlockSize <= text.size(); pos += BlockSize)
+    {
+        const uint64_t separators = Tokenizer::SeparatorMask(data + pos, sep);
+        const uint64_t letters = ~separators & BlockBits;
+
+        // бит i сдвинутой маски — был ли байт перед i-м буквой
+        const uint64_t after_letter = (letters << 1U) | (in_token ? 1U : 0U);
+        uint64_t begins = letters & ~after_letter;
+        uint64_t ends = separators & after_letter;
+
+        // начала и концы чередуются, поэтому следующее событие определяется состоянием
+        while (true)
+        {
+            if (not in_token)
+            {
+                if (begins == 0U)
+                {
+                    break;
+                }
+                token_begin = pos + Tokenizer::LowestBit(begins);
+                begins &= begins - 1U;
+                in_token = true;
+            }
+            else
+            {
+                if (ends == 0U)
+                {
+                    break;
+                }
+                const size_t token_end = pos + Tokenizer::LowestBit(ends);
+                ends &= ends - 1U;
+                in_token = false;
+                func(string_view(data + token_begin, token_end - token_begin));
+            }
+        }
+    }
+#endif
+
+    // хвост короче блока
+    for (; pos < text.size(); ++pos)
+    {
+        if (data[pos] == sep)
+        {
+            if (in_token)
+            {
+                func(string_view(data + token_begin, pos - token_begin));
+                in_token = false;
+            }
+        }
+        else if (not in_token)
+        {
+            token_begin = pos;
+            in_token = true;
+        }
+    }
+    if (in_token)
+    {
+        func(string_view(data + token_begin, text.size() - token_begin));
+    }
+}
+
+template <typename Func>
+void ForEachTokenScalar(string_view text, char sep, Func func)
+{
+    size_t token_begin = 0U;
+    for (size_t pos = 0U; pos < text.size(); ++pos)
+    {
+        if (text[pos] == sep)
+        {
+            if (pos > token_begin)
+            {
+                func(text.substr(token_begin, pos - token_begin));
+            }
+            token_begin = pos + 1U;
+        }
+    }
+    if (text.size() > token_begin)
+    {
+        func(text.substr(token_begin));
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Беззнаковые числа переменной длины (LEB128): по 7 бит в байте, младшие вперёд,
+// старший бит байта означает, что число продолжается. Числа меньше 128 занимают байт
+
+inline void WriteVarint(uint64_t value, vector<uint8_t> &out)
+{
+    while (value >= 0x80U)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80U));
+        value >>= 7U;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Читает число и сдвигает data за него. Данные должны быть записаны WriteVarint
+inline uint64_t ReadVarint(const uint8_t *&data)
+{
+    // в списках документов почти все числа однобайтовые
+    uint64_t result = *data++;
+    if (result < 0x80U)
+    {
+        return result;
+    }
+
+    result &= 0x7FU;
+    for (unsigned shift = 7U;; shift += 7U)
+    {
+        const uint64_t byte = *data++;
+        result |= (byte & 0x7FU) << shift;
+        if (byte < 0x80U)
+        {
+            return result;
+        }
+    }
+}
+
+// То же для числа, за которым в данных есть ещё хотя бы один байт. Одно- и двухбайтовые
+// числа читаются без условных переходов: когда длины чисел чередуются случайно,
+// ошибки предсказания переходов стоят дороже лишнего чтения байта
+inline uint64_t ReadVarintNotLast(const uint8_t *&data)
+{
+    const uint64_t first = data[0];
+    const uint64_t second = data[1];
+    if (((first & second) & 0x80U) == 0U)
+    {
+        const uint64_t second_mask = 0U - (first >> 7U); // все единицы, если число двухбайтовое
+        data += 1U + (first >> 7U);
+        return (first & 0x7FU) | ((second & 0x7FU) << 7U & second_mask);
+    }
+    return ReadVarint(data);
+}